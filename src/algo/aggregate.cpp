@@ -0,0 +1,89 @@
+/*************************************************************************/
+/* sca toolsuite - a toolsuite to simulate cellular automata.            */
+/* Copyright (C) 2011-2014                                               */
+/* Johannes Lorenz                                                       */
+/* https://github.com/JohannesLorenz/sca-toolsuite                       */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+#include "general.h"
+#include "io.h"
+#include "growing_grid.h"
+#include "rotor_algorithm.h"
+
+class MyProgram : public Program
+{
+	exit_t main()
+	{
+		assert_usage(argc == 3 || argc == 5);
+		const char type = argv[1][0];
+		assert_usage(!argv[1][1] && (type == 's' || type == 'r'));
+		const uint64_t number = strtoull(argv[2], nullptr, 10);
+
+		sandpile::growing_grid<int> grid;
+		if(type == 's')
+		{
+			if(number > INT_MAX)
+			 exit("At most 2147483647 grains are possible.");
+			*grid.at(0, 0) = number;
+			sandpile::fix(grid, 0, 0);
+		}
+		else
+		 rotor::rotor_aggregate(grid, number, 0, 0);
+
+		point min, max;
+		if(argc == 5)
+		{ // window centered at the origin
+			const int width = atoi(argv[3]), height = atoi(argv[4]);
+			assert_usage(width > 0 && height > 0);
+			min = point(-(width / 2), -(height / 2));
+			max = point(min.x + width - 1, min.y + height - 1);
+		}
+		else if(!grid.bounding_box(min, max))
+		 min = max = point(0, 0);
+
+		grid_t out(dimension(max.x - min.x + 1, max.y - min.y + 1), 1);
+		grid.to_grid(min, out);
+		if(type == 'r')
+		 for(const point& p : out.points())
+		  --out[p]; // unoccupied cells become -1
+		std::cout << out;
+
+		return exit_t::success;
+	}
+};
+
+int main(int argc, char** argv)
+{
+	HelpStruct help;
+	help.syntax = "algo/aggregate s|r <number> [<width> <height>]";
+	help.description = "Grows an aggregate from the origin of an unbounded grid.\n"
+		"The grid is allocated in tiles when they are first touched,\n"
+		"so no final radius must be guessed.";
+	help.output = "the aggregate, or the window of it";
+	help.add_param("s|r", "s: sandpile, stabilizes <number> grains at the origin,\n"
+		"   r: rotor-router aggregation, prints the rotors of occupied cells\n"
+		"   and -1 for unoccupied cells");
+	help.add_param("<number>", "number of grains or chips");
+	help.add_param("<width> <height>", "size of the window to print, centered at the origin,\n"
+		"   default: the smallest one containing all nonzero cells");
+
+	MyProgram p;
+	return p.run(argc, argv, &help);
+}
@@ -18,21 +18,85 @@
 /* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
 /*************************************************************************/
 
+#include <atomic>
+#include <cstring>
+#include <thread>
+
 #include "general.h"
 #include "grid.h"
+#include "io.h"
 #include "stack_algorithm.h"
+#include "asm_basic.h"
 
 class MyProgram : public Program
 {
+	//! reads grids, separated by empty lines, until the end of stdin,
+	//! and prints whether each one is recurrent
+	exit_t main_batch(unsigned threads)
+	{
+		//! grids read before they are tested together
+		constexpr std::size_t batch_size = 4096;
+		std::vector<std::vector<int>> grids;
+		std::vector<dimension> dims;
+		std::vector<char> recurrent;
+		std::vector<sandpile::burning_test> tests(threads);
+
+		for(bool eof = false; !eof; )
+		{
+			grids.clear();
+			dims.clear();
+			while(!eof && grids.size() < batch_size)
+			{
+				std::vector<int> grid;
+				dimension dim;
+				read_grid(stdin, &grid, &dim);
+				if(dim.height() > 2)
+				{
+					grids.push_back(std::move(grid));
+					dims.push_back(dim);
+				}
+				else // empty line or end of file
+				 eof = feof(stdin);
+			}
+
+			recurrent.assign(grids.size(), 0);
+			std::atomic<std::size_t> next_grid(0);
+			const auto work = [&](unsigned thread_id)
+			{
+				std::size_t g;
+				while((g = next_grid++) < grids.size())
+				 recurrent[g] = tests[thread_id](grids[g], dims[g]);
+			};
+			std::vector<std::thread> pool;
+			for(unsigned t = 1; t < threads; ++t)
+			 pool.emplace_back(work, t);
+			work(0);
+			for(std::thread& th : pool)
+			 th.join();
+
+			for(const char& r : recurrent)
+			 puts(r ? "recurrent" : "transient");
+		}
+		return exit_t::success;
+	}
+
 	exit_t main()
 	{
 		using cell_t = def_cell_traits::cell_t;
 		using coord_t = def_coord_traits::coord_t;
 
+		if(argc > 1 && !strcmp(argv[1], "batch"))
+		{
+			assert_usage(argc <= 3);
+			const int threads = (argc == 3) ? atoi(argv[2]) : 1;
+			assert_usage(threads > 0);
+			return main_batch(threads);
+		}
+
 		assert_usage(argc==1);
 
 		std::istream& read_fp = std::cin;
-		grid_t grid(read_fp, 1);
+		grid_t grid(read_fp, 1, std::numeric_limits<int>::min());
 		const dimension& hdim = grid.human_dim();
 		const unsigned int width = hdim.width();
 
@@ -42,8 +106,8 @@ class MyProgram : public Program
 		for(const point& p : hdim.points(0))
 		{
 			grid[p] +=
-				(cell_t)((p.x % width)*((p.x+1)%(width)) == 0) +
-				(cell_t)((p.y == 0) || (p.y == lowest));
+				(cell_t)(p.x == 0) + (cell_t)(p.x == (coord_t)width - 1) +
+				(cell_t)(p.y == 0) + (cell_t)(p.y == lowest);
 		}
 
 		// stabilize everything
@@ -67,10 +131,16 @@ class MyProgram : public Program
 int main(int argc, char** argv)
 {
 	HelpStruct help;
-	help.description = "Runs burning test.";
-	help.syntax = "algo/burning_test";
-	help.input = "grid to test";
-	help.output = "resulting avalanches, binary";
+	help.description = "Runs burning test.\n"
+		"The exit code is 0 iff the grid is recurrent.";
+	help.syntax = "algo/burning_test\n"
+		"algo/burning_test batch [<threads>]";
+	help.input = "grid to test; for batch, grids separated by empty lines";
+	help.output = "resulting avalanches, binary;\n"
+		"   for batch, one line \"recurrent\" or \"transient\" per grid";
+	help.add_param("batch", "tests many grids without logging, much faster than\n"
+		"   one process per grid");
+	help.add_param("<threads>", "number of threads for batch, default 1");
 
 	MyProgram p;
 	return p.run(argc, argv, &help);
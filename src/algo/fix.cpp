@@ -24,6 +24,10 @@
 #include "general.h"
 #include "io.h"
 #include "stack_algorithm.h"
+#include "parallel_fix.h"
+#include "least_action_fix.h"
+#include "varint_log.h"
+#include "perf_counters.h"
 
 template<class AvalancheContainer, class Logger>
 void run(grid_t& grid, int hint=-1)
@@ -38,6 +42,56 @@ void run(grid_t& grid, int hint=-1)
 	 fix(grid.data(), grid.internal_dim(), human2internal(hint, grid.internal_dim().width()), container, logger);
 }
 
+//! like run() for s, but on a copy of @a grid with cell type T
+template<class T>
+void run_narrow(grid_t& grid, int hint=-1)
+{
+	const dimension& dim = grid.internal_dim();
+	std::vector<T> cells = sandpile::to_cell_type<T>(grid.data(), dim);
+	sandpile::_array_stack_compact<T*> container(grid.human_dim().area());
+	sandpile::_fix_log_s<T*> logger(stdout);
+	if(hint == -1)
+	 fix(cells, dim, container, logger);
+	else
+	 fix(cells, dim, human2internal(hint, dim.width()), container, logger);
+	for(unsigned i = 0; i < cells.size(); ++i)
+	 if(!is_border(dim, i))
+	  grid.data()[i] = cells[i];
+}
+
+//! runs s on the narrowest cell type that can hold all grains
+//! narrow types mean less memory bandwidth for large grids
+void run_s(grid_t& grid, int hint=-1)
+{
+	if(sandpile::fits_fix<int8_t>(grid.data(), grid.internal_dim()))
+	 run_narrow<int8_t>(grid, hint);
+	else if(sandpile::fits_fix<int16_t>(grid.data(), grid.internal_dim()))
+	 run_narrow<int16_t>(grid, hint);
+	else
+	 ::run<sandpile::array_stack_compact,
+		sandpile::fix_log_s>(grid, hint);
+}
+
+//! like run(), but prints hardware counters and topples instead of the grid
+void run_counters(grid_t& grid, int hint=-1)
+{
+	uint64_t grains = 0;
+	for(const point& p : grid.human_dim().points(0))
+	 grains += grid[p];
+
+	sandpile::counting<sandpile::array_stack_compact>
+		container(grid.human_dim().area());
+	sandpile::fix_log_count<int*> logger(stdout);
+	sandpile::perf_counters counters;
+	counters.start();
+	if(hint == -1)
+	 fix(grid.data(), grid.internal_dim(), container, logger);
+	else
+	 fix(grid.data(), grid.internal_dim(), human2internal(hint, grid.internal_dim().width()), container, logger);
+	counters.stop();
+	counters.print(stdout, grains, logger.topples(), container.pushes());
+}
+
 class MyProgram : public Program
 {
 	exit_t main()
@@ -51,26 +105,43 @@ class MyProgram : public Program
 			case 2:
 				output_type = argv[1][0];
 				assert_usage(!argv[1][1] &&
-					(output_type=='l'||output_type=='s'));
+					(output_type=='l'||output_type=='s'
+					||output_type=='v'||output_type=='p'
+					||output_type=='c'));
 				break;
 			default:
 				return exit_usage();
 		}
 
-		grid_t grid(read_fp, 1);
+		grid_t grid(read_fp, 1, std::numeric_limits<int>::min());
 
 		switch(output_type) {
-			case 'l': ::run<sandpile::array_stack,
-					sandpile::fix_log_l>(
+			case 'l': ::run<sandpile::array_stack_compact,
+					sandpile::fix_log_la>(
+					grid, hint);
+				break;
+			case 'v': ::run<sandpile::array_stack_compact,
+					sandpile::fix_log_v>(
 					grid, hint);
 				break;
+			case 'c': run_counters(grid, hint); break;
 		//	case 'h': run<ArrayStack, FixLogLHuman>(grid, dim, hint); break;
 			case 's':
-				::run<sandpile::array_stack,
-					sandpile::fix_log_s>(
-					grid, hint);
+				if(hint == -1 && sandpile::least_action_is_faster(
+					grid.data(), grid.internal_dim()))
+				 sandpile::least_action_fix(grid.data(),
+					grid.internal_dim());
+				else
+				 run_s(grid, hint);
 				std::cout << grid;
 				break;
+			case 'p': {
+				const int threads = hint; // 2nd param for p
+				assert_usage(threads > 0);
+				sandpile::parallel_fix(grid.data(),
+					grid.internal_dim(), threads);
+				std::cout << grid;
+			}	break;
 		}
 		return exit_t::success;
 	}
@@ -80,11 +151,18 @@ int main(int argc, char** argv)
 {
 	HelpStruct help;
 	help.description = "Runs the stabilisation algorithm until grid is stable.\n"
-		"Algorithm runs correctly on every configuration >= 0.";
+		"Algorithm runs correctly on every configuration >= 0.\n"
+		"For s without hint, grids with few, but large piles are\n"
+		"stabilized by computing the odometer (least action principle).";
 	help.input = "input grid";
-	help.syntax = "algo/fix s|l [<hint>]";
-	help.add_param("s|l", "s calculates resulting grid, l the number each cell fires");
+	help.syntax = "algo/fix s|l|v|c [<hint>]\n"
+		"algo/fix p <threads>";
+	help.add_param("s|l|v|c", "s calculates resulting grid, l the number each cell fires,\n"
+		"   v is like l, but compressed, c prints hardware counters,\n"
+		"   topples and pushes per 10.000 grains (profiling)");
 	help.add_param("<hint>", "only ensures that cell at hint will be fired");
+	help.add_param("p", "like s without hint, but using multiple threads");
+	help.add_param("<threads>", "number of threads for p");
 
 	MyProgram program;
 	return program.run(argc, argv, &help);
@@ -30,10 +30,12 @@ class MyProgram : public Program
 {
 	exit_t main()
 	{
-		assert_usage(argc == 3);
+		assert_usage(argc == 3 || argc == 4);
 		dimension dim(atoi(argv[1]), atoi(argv[2]));
+		const int threads = (argc == 4) ? atoi(argv[3]) : 1;
+		assert_usage(threads > 0);
 
-		std::cout << sandpile::get_identity(dim);
+		std::cout << sandpile::get_identity(dim, threads);
 		return exit_t::success;
 	}
 };
@@ -41,9 +43,11 @@ class MyProgram : public Program
 int main(int argc, char** argv)
 {
 	HelpStruct help;
-	help.syntax = "algo/id <width> <height>";
-	help.description = "Creates the identity element of ASM group.";
+	help.syntax = "algo/id <width> <height> [<threads>]";
+	help.description = "Creates the identity element of ASM group.\n"
+		"If $SCA_IDENTITY_CACHE is set, identities are cached there (see algo/id_cache).";
 	help.output = "grid containing the identity";
+	help.add_param("<threads>", "number of threads for stabilizing, default 1");
 
 	MyProgram p;
 	return p.run(argc, argv, &help);
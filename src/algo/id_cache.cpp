@@ -0,0 +1,66 @@
+/*************************************************************************/
+/* sca toolsuite - a toolsuite to simulate cellular automata.            */
+/* Copyright (C) 2011-2014                                               */
+/* Johannes Lorenz                                                       */
+/* https://github.com/JohannesLorenz/sca-toolsuite                       */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#include <cstdlib>
+#include <cstdio>
+
+#include "asm_basic.h"
+#include "general.h"
+
+class MyProgram : public Program
+{
+	exit_t main()
+	{
+		assert_usage(argc == 6 || argc == 7);
+		const char* dir = argv[1];
+		const int w_min = atoi(argv[2]), w_max = atoi(argv[3]),
+			h_min = atoi(argv[4]), h_max = atoi(argv[5]);
+		const int threads = (argc == 7) ? atoi(argv[6]) : 1;
+		assert_usage(w_min > 0 && w_min <= w_max
+			&& h_min > 0 && h_min <= h_max && threads > 0);
+
+		for(int h = h_min; h <= h_max; ++h)
+		for(int w = w_min; w <= w_max; ++w)
+		{
+			const dimension dim(w, h);
+			grid_t identity;
+			if(sca::io::load_identity(dir, dim, identity))
+			 continue;
+			identity = sandpile::compute_identity(dim, threads);
+			if(!sca::io::store_identity(dir, identity))
+			 exit("Could not write to the cache directory.");
+		}
+		return exit_t::success;
+	}
+};
+
+int main(int argc, char** argv)
+{
+	HelpStruct help;
+	help.syntax = "algo/id_cache <dir> <min width> <max width> <min height> <max height> [<threads>]";
+	help.description = "Fills the identity cache for all given dimensions.\n"
+		"Entries which exist and are valid are kept.\n"
+		"algo/id and algo/super use the cache if $SCA_IDENTITY_CACHE is set to <dir>.";
+	help.add_param("<dir>", "cache directory, must exist");
+	help.add_param("<threads>", "number of threads for stabilizing, default 1");
+
+	MyProgram p;
+	return p.run(argc, argv, &help);
+}
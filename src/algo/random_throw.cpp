@@ -23,72 +23,520 @@
 #include <cstring>
 #include <cstdio>
 #include <vector>
-#include <climits>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "random.h"
 #include "general.h"
 #include "io.h"
 #include "stack_algorithm.h"
+#include "avalanche_stats.h"
+#include "varint_log.h"
+#include "drop_sequence.h"
+#include "speculative_drops.h"
+#include "tiled_grid.h"
+#include "perf_counters.h"
+#include "io/throw_checkpoint.h"
+
+/*
+ * log synchronization for checkpoints
+ */
+//! makes everything logged so far appear in the output
+//! @return the state which resume_log() needs to continue the log
+template<class T>
+int64_t sync_log(sandpile::_array_stack_compact<T>& ) { return 0; }
+template<class T>
+int64_t sync_log(sandpile::_array_queue_stats<T>& ) { return 0; }
+template<class T>
+int64_t sync_log(sandpile::_array_queue_varint<T>& log) {
+	log.sync();
+	return log.last_index();
+}
+
+template<class T>
+void resume_log(sandpile::_array_stack_compact<T>& , int64_t ) {}
+template<class T>
+void resume_log(sandpile::_array_queue_stats<T>& , int64_t ) {}
+template<class T>
+void resume_log(sandpile::_array_queue_varint<T>& log, int64_t state) {
+	log.resume(state);
+}
+
+//! checkpoint policy for runs without checkpoints
+class no_checkpoints
+{
+public:
+	constexpr bool due() const { return false; }
+	template<class ...Args>
+	void save(const Args& ...) const {}
+	template<class Container>
+	void resume(Container& ) const {}
+};
+
+/**
+	@brief Checkpoint policy writing a checkpoint every some
+	grains or seconds, whatever comes first.
+
+	The clock is only read every 1024 grains, to keep the overhead low.
+*/
+class checkpoints
+{
+	using clock = std::chrono::steady_clock;
+	sca::io::throw_checkpoint& state;
+	const char* const filename;
+	const bool resumed;
+	//! where the log starts in stdout, or -1 if stdout is no file
+	const int64_t out_start;
+	uint64_t since_last = 0;
+	clock::time_point last_time = clock::now();
+
+	static int64_t output_position()
+	{
+		struct stat st;
+		if(fstat(fileno(stdout), &st) || !S_ISREG(st.st_mode))
+		 return -1;
+		// in append mode, the position is only moved by writing
+		return (fcntl(fileno(stdout), F_GETFL) & O_APPEND)
+			? (int64_t)st.st_size : (int64_t)ftello(stdout);
+	}
+public:
+	//! @param state parameters of the run, and the state if @a resumed
+	checkpoints(sca::io::throw_checkpoint& state, const char* filename,
+		bool resumed) :
+		state(state),
+		filename(filename),
+		resumed(resumed),
+		// a resumed log has been truncated and continues at its end
+		out_start(resumed ? 0 : output_position())
+	{}
+
+	//! must be called after each drop
+	inline bool due()
+	{
+		++state.done;
+		++since_last;
+		return (state.every_grains && since_last >= state.every_grains)
+			|| (state.every_seconds && !(since_last & 1023)
+			&& clock::now() - last_time
+				>= std::chrono::seconds(state.every_seconds));
+	}
+
+	template<class T, class Container>
+	void save(const std::vector<T>& grid,
+		const sandpile::random_drops& drops, Container& container)
+	{
+		state.grid.assign(grid.begin(), grid.end());
+		std::copy_n(drops.generator().state(), 4, state.rng_state);
+		state.log_state = sync_log(container);
+		fflush(stdout);
+		state.log_offset = (out_start < 0) ? -1
+			: output_position() - out_start;
+		if(!state.write(filename))
+		 fputs("Warning: could not write checkpoint.\n", stderr);
+		since_last = 0;
+		last_time = clock::now();
+	}
+
+	template<class Container>
+	void resume(Container& container) const
+	{
+		if(resumed)
+		 resume_log(container, state.log_state);
+	}
+};
 
 class MyProgram : public Program
 {
 	// Note: don't put the parameters into this class. It misses the const otherwise,
 	// and thus makes the algorithm a lot slower (tested)
-	template<class AvalancheContainer, class T>
+	template<class AvalancheContainer, class T, class Drops,
+		class Checkpoints = no_checkpoints>
 	void start(std::vector<T>& grid,
 		const dimension& dim,
-		const std::vector<int>& random_seq)
+		Drops drops,
+		AvalancheContainer& avalanche_container,
+		Checkpoints&& ckpt = Checkpoints())
 	{
-		FILE* const out_fp = stdout;
-		AvalancheContainer avalanche_container(dim.area_without_border(), out_fp);
-		for(unsigned int round = 0; round < random_seq.size(); round++)
+		ckpt.resume(avalanche_container);
+		sandpile::border_guard<T> guard;
+		unsigned idx;
+		while(drops.next(idx))
 		{
-			grid[random_seq[round]]++;
+			grid[idx]++;
 	/*		for(int i = 0; i < grid.size(); ++i) {
 				if(grid[i]==-1)
 					assert(false);
 			}*/
-			sandpile::l_hint<T>(grid, dim, random_seq[round],
-				avalanche_container);
+			sandpile::l_hint<T>(grid, dim, idx,
+				avalanche_container, guard);
+			if(ckpt.due())
+			 ckpt.save(grid, drops, avalanche_container);
 		}
 	}
 
+	//! internal area from which start_tiled() uses a tiled_layout
+	static constexpr std::size_t tiled_min_area = 4096 * 4096;
+	//! the conversion only pays off for at least area / this drops
+	static constexpr std::size_t tiled_cells_per_drop = 8;
+
+	//! returns whether start_tiled() uses a tiled_layout for @a drops
+	//! drops. $SCA_TILED_LAYOUT can be "always" or "never"
+	static bool use_tiled(const dimension& dim, uint64_t drops)
+	{
+		const char* const env = getenv("SCA_TILED_LAYOUT");
+		if(env && !strcmp(env, "always"))
+		 return true;
+		else if(env && !strcmp(env, "never"))
+		 return false;
+		else
+		 return dim.area() >= tiled_min_area
+			&& drops >= dim.area() / tiled_cells_per_drop;
+	}
+
+	//! like start(), but runs large grids in a tiled_layout, which is
+	//! faster if the grid is much larger than the cache
+	template<class AvalancheContainer, class T, class Drops>
+	void start_tiled(std::vector<T>& grid,
+		const dimension& dim,
+		const Drops& drops,
+		AvalancheContainer& avalanche_container,
+		no_checkpoints& )
+	{
+		if(!use_tiled(dim, drops.remaining()))
+		{
+			start(grid, dim, drops, avalanche_container);
+			return;
+		}
+		const sandpile::tiled_layout<> layout(dim);
+		std::vector<T> tiled = layout.to_tiled(grid);
+		sandpile::tiled_drops<Drops, 4> tiled_drops(drops, layout);
+		sandpile::border_guard<T> guard;
+		unsigned idx;
+		while(tiled_drops.next(idx))
+		{
+			tiled[idx]++;
+			sandpile::l_hint(tiled, layout, idx,
+				avalanche_container, guard);
+		}
+		layout.from_tiled(tiled, grid);
+	}
+
+	//! checkpoints store row-major grids, so no tiled_layout is used
+	template<class AvalancheContainer, class T, class Drops,
+		class Checkpoints>
+	void start_tiled(std::vector<T>& grid,
+		const dimension& dim,
+		const Drops& drops,
+		AvalancheContainer& avalanche_container,
+		Checkpoints& ckpt)
+	{
+		start(grid, dim, drops, avalanche_container, ckpt);
+	}
+
+	//! runs on a copy of @a grid with cell type T
+	//! narrow types mean less memory bandwidth for large grids
+	template<class T, class LogType, class Drops, class Checkpoints>
+	void start_narrow(std::vector<int>& grid,
+		const dimension& dim,
+		const Drops& drops,
+		LogType log_type,
+		Checkpoints& ckpt)
+	{
+		FILE* const out_fp = stdout;
+		std::vector<T> narrow_grid
+			= sandpile::to_cell_type<T>(grid, dim);
+		switch(log_type)
+		{
+			case LogType::avalanches: {
+				sandpile::_array_queue_async<T*> container(
+					dim.area_without_border(), out_fp);
+				start(narrow_grid, dim, drops, container);
+			} break;
+			case LogType::compressed: {
+				sandpile::_array_queue_varint<T*> container(
+					dim.area_without_border(), out_fp);
+				start(narrow_grid, dim, drops, container, ckpt);
+			} break;
+			case LogType::histograms:
+			case LogType::records: {
+				sandpile::_array_queue_stats<T*> container(dim, out_fp,
+					(log_type == LogType::records)
+					? sandpile::stats_output::records
+					: sandpile::stats_output::histograms);
+				if(log_type == LogType::records)
+				 start(narrow_grid, dim, drops, container, ckpt);
+				else
+				 start(narrow_grid, dim, drops, container);
+				container.finish();
+			} break;
+			case LogType::counters: {
+				sandpile::counting<sandpile::_array_stack_compact<T*>>
+					container(dim.area_without_border());
+				sandpile::perf_counters counters;
+				counters.start();
+				start(narrow_grid, dim, drops, container);
+				counters.stop();
+				counters.print(out_fp, container.avalanches(),
+					container.pops(), container.pushes());
+			} break;
+			default: {
+				sandpile::_array_stack_compact<T*> container(
+					dim.area_without_border(), out_fp);
+				start_tiled(narrow_grid, dim, drops, container, ckpt);
+				std::copy(narrow_grid.begin(), narrow_grid.end(),
+					grid.begin());
+				if(log_type == LogType::end)
+				 write_grid(stdout, &grid, &dim);
+			}
+		}
+	}
+
+	//! chooses the cell type and runs
+	template<class LogType, class Drops, class Checkpoints = no_checkpoints>
+	void start_any(std::vector<int>& grid,
+		const dimension& dim,
+		const Drops& drops,
+		LogType log_type,
+		Checkpoints&& ckpt = Checkpoints())
+	{
+		// use the narrowest cell type which can hold the grid
+		if(sandpile::fits_cell_type<int8_t>(grid, dim))
+		 start_narrow<int8_t>(grid, dim, drops, log_type, ckpt);
+		else if(sandpile::fits_cell_type<int16_t>(grid, dim))
+		 start_narrow<int16_t>(grid, dim, drops, log_type, ckpt);
+		else
+		 start_narrow<int>(grid, dim, drops, log_type, ckpt);
+	}
+
+	/**
+		Runs @a replicas independent runs with the seeds
+		@a first_seed, @a first_seed + 1, ... on @a threads threads.
+		Each run works on its own copy of @a grid. Prints either all
+		final grids in the order of the seeds, or the merged histograms.
+	*/
+	template<class T, class LogType>
+	void start_ensemble_narrow(const std::vector<int>& grid,
+		const dimension& dim, uint64_t number, uint64_t first_seed,
+		unsigned replicas, unsigned threads, LogType log_type)
+	{
+		using stats_t = sandpile::_array_queue_stats<T*>;
+		const std::vector<T> narrow_grid
+			= sandpile::to_cell_type<T>(grid, dim);
+		std::vector<std::vector<T>> results(replicas);
+		// one per thread, merged afterwards
+		std::vector<std::unique_ptr<stats_t>> stats(threads);
+		std::atomic<unsigned> next_replica(0);
+
+		const auto work = [&](unsigned thread_id)
+		{
+			if(log_type == LogType::histograms)
+			 stats[thread_id].reset(new stats_t(dim, stdout));
+			sandpile::_array_stack_compact<T*> container(
+				dim.area_without_border());
+			unsigned r;
+			while((r = next_replica++) < replicas)
+			{
+				results[r] = narrow_grid;
+				sandpile::random_drops drops(first_seed + r, number, dim);
+				if(log_type == LogType::histograms)
+				{
+					start(results[r], dim, drops, *stats[thread_id]);
+					results[r].clear(); // only the histograms matter
+				}
+				else
+				 start(results[r], dim, drops, container);
+			}
+		};
+
+		std::vector<std::thread> pool;
+		for(unsigned t = 1; t < threads; ++t)
+		 pool.emplace_back(work, t);
+		work(0);
+		for(std::thread& th : pool)
+		 th.join();
+
+		if(log_type == LogType::histograms)
+		{
+			for(unsigned t = 1; t < threads; ++t)
+			 stats[0]->merge(*stats[t]);
+			stats[0]->finish();
+		}
+		else if(log_type == LogType::end)
+		{
+			std::vector<int> out_grid(grid);
+			for(unsigned r = 0; r < replicas; ++r)
+			{
+				std::copy(results[r].begin(), results[r].end(),
+					out_grid.begin());
+				if(r)
+				 fputs("\n", stdout);
+				write_grid(stdout, &out_grid, &dim);
+			}
+		}
+	}
+
+	//! chooses the cell type and runs the ensemble
+	template<class LogType>
+	void start_ensemble(const std::vector<int>& grid,
+		const dimension& dim, uint64_t number, uint64_t first_seed,
+		unsigned replicas, unsigned threads, LogType log_type)
+	{
+		if(sandpile::fits_cell_type<int8_t>(grid, dim))
+		 start_ensemble_narrow<int8_t>(grid, dim, number, first_seed,
+			replicas, threads, log_type);
+		else if(sandpile::fits_cell_type<int16_t>(grid, dim))
+		 start_ensemble_narrow<int16_t>(grid, dim, number, first_seed,
+			replicas, threads, log_type);
+		else
+		 start_ensemble_narrow<int>(grid, dim, number, first_seed,
+			replicas, threads, log_type);
+	}
+
+	//! runs @a drops with a speculative_dropper on @a threads threads
+	template<class T, class LogType>
+	void start_parallel_narrow(std::vector<int>& grid,
+		const dimension& dim, sandpile::random_drops drops,
+		unsigned threads, LogType log_type)
+	{
+		std::vector<T> narrow_grid
+			= sandpile::to_cell_type<T>(grid, dim);
+		sandpile::speculative_dropper<T> dropper(narrow_grid, dim,
+			threads, 256 * threads);
+		switch(log_type)
+		{
+			case LogType::avalanches: {
+				sandpile::_fix_log_la<T*> log(stdout);
+				dropper.run(narrow_grid, drops, log);
+			} break;
+			case LogType::compressed: {
+				sandpile::_fix_log_v<T*> log(stdout);
+				dropper.run(narrow_grid, drops, log);
+			} break;
+			default: {
+				sandpile::internal::log_none<T*> log;
+				dropper.run(narrow_grid, drops, log);
+				std::copy(narrow_grid.begin(), narrow_grid.end(),
+					grid.begin());
+				if(log_type == LogType::end)
+				 write_grid(stdout, &grid, &dim);
+			}
+		}
+	}
+
+	//! positions stdout at the end of the log written until the checkpoint
+	void restore_output(int64_t log_offset)
+	{
+		if(log_offset <= 0)
+		 return;
+		struct stat st;
+		if(fstat(fileno(stdout), &st) || !S_ISREG(st.st_mode))
+		 exit("Resuming needs the log file of the interrupted run as output.");
+		if(st.st_size < log_offset)
+		 exit("The log file is shorter than at the checkpoint.");
+		if(ftruncate(fileno(stdout), log_offset)
+			|| fseeko(stdout, log_offset, SEEK_SET))
+		 exit("Could not truncate the log file.");
+	}
+
 	exit_t main()
 	{
 		std::vector<int> grid;
 		dimension dim;
 		std::vector<int> random_seq;
+		std::unique_ptr<sca::io::seqfile_reader> seq_reader;
+		uint64_t number = 0, seed = 0;
+		sca::io::throw_checkpoint ckpt_state;
+		const char* ckpt_file = nullptr;
+		unsigned replicas = 0, threads = 1;
 
-		assert_usage(argc>=4 && argc <=5);
+		assert_usage(argc >= 2);
+		const bool resume_mode = !strcmp(argv[1], "resume");
+		const bool ensemble_mode = !strcmp(argv[1], "ensemble");
+		const bool parallel_mode = !strcmp(argv[1], "parallel");
+		assert_usage(resume_mode ? (argc == 3)
+			: ensemble_mode ? (argc == 6 || argc == 7)
+			: parallel_mode ? (argc == 5 || argc == 6)
+			: (argc == 4 || argc == 5 || argc == 8));
+		const char* log_arg = ensemble_mode
+			? ((argc == 7) ? argv[6] : "s")
+			: parallel_mode ? ((argc == 6) ? argv[5] : "s")
+			: ((argc >= 5) ? argv[4] : "s");
 
-		if(!strcmp(argv[1], "random"))
+		const bool random_mode = !strcmp(argv[1], "random");
+		if(resume_mode)
+		{ // continue from a checkpoint, all parameters are stored there
+			ckpt_file = argv[2];
+			ckpt_state.read(ckpt_file);
+			dim = dimension(ckpt_state.width, ckpt_state.height);
+			grid.assign(ckpt_state.grid.begin(), ckpt_state.grid.end());
+			number = ckpt_state.number;
+			seed = ckpt_state.seed;
+			log_arg = &ckpt_state.log_type;
+		}
+		else if(ensemble_mode)
+		{ // like random, but with many seeds
+			read_grid(stdin, &grid, &dim);
+			number = strtoull(argv[2], nullptr, 10);
+			seed = strtoull(argv[3], nullptr, 10);
+			replicas = atoi(argv[4]);
+			threads = atoi(argv[5]);
+			assert_usage(replicas > 0 && threads > 0);
+			threads = std::min(threads, replicas);
+		}
+		else if(parallel_mode)
+		{ // like random, but speculating on multiple threads
+			read_grid(stdin, &grid, &dim);
+			number = strtoull(argv[2], nullptr, 10);
+			seed = strtoull(argv[3], nullptr, 10);
+			threads = atoi(argv[4]);
+			assert_usage(threads > 0);
+		}
+		else if(random_mode)
 		{ // user gives us the random seed, the number, and the initial board via stdin
 			read_grid(stdin, &grid, &dim);
 
-			random_seq.resize(atoi(argv[2]));
-			sca_random::set_seed(atoi(argv[3]));
-
-			const int area = dim.area_without_border();
-
-			for(std::vector<int>::iterator itr = random_seq.begin();
-				itr != random_seq.end(); itr++) {
-				*itr = human2internal(sca_random::get_int(area-1), dim.width());
+			// drops are generated while running
+			number = strtoull(argv[2], nullptr, 10);
+			if(!strcmp(argv[3], "-"))
+			{
+				seed = sca_random::find_good_seed();
+				fprintf(stderr, "seed: %llu\n",
+					(unsigned long long)seed);
 			}
+			else
+			 seed = strtoull(argv[3], nullptr, 10);
 		}
 		else if(!strcmp(argv[1], "input"))
 		{ // user lets us read "random" sequence from stdin, we create an empty board of wxh
 			dim = dimension(atoi(argv[2]) + 2, atoi(argv[3]) + 2);
 			create_empty_grid(grid, dim);
 
-			bool eof = false;
-			do
+			if(sca::io::seqfile_reader::is_binary(stdin))
 			{
-				int i;
-				if( fscanf(stdin, "%d", &i) != 1)
-				 eof=true;
-				else
-				 random_seq.push_back(human2internal(i, dim.width()));
-			} while(!eof);
+				seq_reader.reset(new sca::io::seqfile_reader(stdin));
+				const sca::io::seq_header& hdr = seq_reader->header();
+				if(hdr.width != dim.width() - 2
+					|| hdr.height != dim.height() - 2)
+				 exit("Dimension of the binary sequence does not match.");
+			}
+			else
+			{
+				bool eof = false;
+				do
+				{
+					int i;
+					if( fscanf(stdin, "%d", &i) != 1)
+					 eof=true;
+					else
+					 random_seq.push_back(human2internal(i, dim.width()));
+				} while(!eof);
+			}
 		}
 		else
 		 exit_usage();
@@ -96,35 +544,96 @@ class MyProgram : public Program
 		enum class log_type_t // TODO: -> ASM BASIC?
 		{
 			avalanches,
+			compressed,
+			histograms,
+			records,
+			counters,
 			end,
 			nothing
 		};
 		log_type_t log_type = log_type_t::end;
 
-		if(argc==5)
+		// in resume mode, log_arg points to one char
+		assert_usage(log_arg[0] && (resume_mode || !log_arg[1]));
+		switch(log_arg[0])
 		{
-			if(!strcmp(argv[4], "l")) log_type = log_type_t::avalanches;
-			else if(!strcmp(argv[4], "s")) log_type = log_type_t::end;
-			else if(!strcmp(argv[4], "n")) log_type = log_type_t::nothing;
-			else exit_usage();
-		}
-
-		std::vector<int> char_grid(grid.size()); // (TODO)
-		char_grid.resize(grid.size());
-		for(std::size_t i = 0; i < grid.size(); ++i) {
-			char_grid[i] = (grid[i] < CHAR_MIN) ? CHAR_MIN : grid[i];
-		}
-		if(log_type == log_type_t::avalanches) {
-			start<sandpile::_array_queue<int*>>(char_grid, dim, random_seq);
-		} else {
-			start<sandpile::_array_stack<int*>>(char_grid, dim, random_seq);
-			for(std::size_t i = 0; i < grid.size(); ++i) {
-				grid[i] = char_grid[i];
-			}
-			if(log_type == log_type_t::end)
-			 write_grid(stdout, &grid, &dim);
+			case 'l': log_type = log_type_t::avalanches; break;
+			case 'v': log_type = log_type_t::compressed; break;
+			case 'h': log_type = log_type_t::histograms; break;
+			case 'r': log_type = log_type_t::records; break;
+			case 'c': log_type = log_type_t::counters; break;
+			case 's': log_type = log_type_t::end; break;
+			case 'n': log_type = log_type_t::nothing; break;
+			default: exit_usage();
 		}
 
+		if(argc == 8)
+		{
+			assert_usage(random_mode);
+			if(log_type == log_type_t::avalanches
+				|| log_type == log_type_t::histograms
+				|| log_type == log_type_t::counters)
+			 exit("Checkpoints are not possible for log types 'l', 'h' and 'c'.");
+			ckpt_file = argv[5];
+			ckpt_state.width = dim.width();
+			ckpt_state.height = dim.height();
+			ckpt_state.number = number;
+			ckpt_state.seed = seed;
+			ckpt_state.log_type = log_arg[0];
+			ckpt_state.every_grains = strtoull(argv[6], nullptr, 10);
+			ckpt_state.every_seconds = strtoull(argv[7], nullptr, 10);
+		}
+
+		if(ensemble_mode)
+		{
+			if(log_type != log_type_t::end
+				&& log_type != log_type_t::histograms
+				&& log_type != log_type_t::nothing)
+			 exit("Ensembles only support the log types 's', 'h' and 'n'.");
+			start_ensemble(grid, dim, number, seed, replicas, threads,
+				log_type);
+		}
+		else if(parallel_mode && threads > 1)
+		{
+			if(log_type == log_type_t::histograms
+				|| log_type == log_type_t::records
+				|| log_type == log_type_t::counters)
+			 exit("Parallel mode does not support the log types 'h', 'r' and 'c'.");
+			sandpile::random_drops drops(seed, number, dim);
+			if(sandpile::fits_cell_type<int8_t>(grid, dim))
+			 start_parallel_narrow<int8_t>(grid, dim, drops,
+				threads, log_type);
+			else if(sandpile::fits_cell_type<int16_t>(grid, dim))
+			 start_parallel_narrow<int16_t>(grid, dim, drops,
+				threads, log_type);
+			else
+			 start_parallel_narrow<int>(grid, dim, drops,
+				threads, log_type);
+		}
+		else if(resume_mode)
+		{
+			restore_output(ckpt_state.log_offset);
+			sca_random::xoshiro256ss rng(0);
+			std::copy_n(ckpt_state.rng_state, 4, rng.state());
+			start_any(grid, dim,
+				sandpile::random_drops(rng,
+					number - ckpt_state.done, dim),
+				log_type, checkpoints(ckpt_state, ckpt_file, true));
+		}
+		else if(ckpt_file)
+		 start_any(grid, dim,
+			sandpile::random_drops(seed, number, dim), log_type,
+			checkpoints(ckpt_state, ckpt_file, false));
+		else if(random_mode || parallel_mode) // parallel with 1 thread
+		 start_any(grid, dim,
+			sandpile::random_drops(seed, number, dim), log_type);
+		else if(seq_reader)
+		 start_any(grid, dim,
+			sandpile::seqfile_drops(*seq_reader, dim), log_type);
+		else
+		 start_any(grid, dim,
+			sandpile::vector_drops(random_seq), log_type);
+
 		return exit_t::success;
 	}
 };
@@ -135,14 +644,36 @@ int main(int argc, char** argv)
 	help.description = "The random sandpile algorithm, which stabilizes configurations given by randomly thrown grains.\n"
 		"There are two modes 'random' and 'input'' with different parameters and behaviour.\n"
 		"In 'random', the given input grid is added random numbers.\n"
-		"In 'input', the zero grid is added the numbers from the given random sequence";
-	help.input = "the initial configuration ('input') or the sequence of numbers ('random').";
-	help.syntax = "algo/random_throw random <number> <seed> [<logtype>]\n"
-		"algo/random_throw input <width> <height> [<logtype>]";
-	help.add_param("(1st parameter)", "defines which of the two modes to use");
+		"In 'input', the zero grid is added the numbers from the given random sequence.\n"
+		"'resume' continues an interrupted 'random' run from a checkpoint, with the same output.\n"
+		"For log types 'v' and 'r', the output must be the log of the interrupted run,\n"
+		"opened for appending (e.g. >> log), it is truncated to the size at the checkpoint.\n"
+		"'ensemble' does 'random' runs for the seeds <seed> to <seed>+<replicas>-1 on\n"
+		"<threads> threads. It prints all final grids, separated by empty lines,\n"
+		"or the histograms of all runs together.\n"
+		"'parallel' is 'random' for one seed, relaxing windows of drops speculatively\n"
+		"on <threads> threads, with the same output (not for log types 'h', 'r' and 'c').\n"
+		"For log types 's' and 'n' without checkpoints, grids of at least 4096 x 4096 cells\n"
+		"with at least one drop per 8 cells are run in a tiled layout. Setting\n"
+		"$SCA_TILED_LAYOUT to 'always' or 'never' overrides this.";
+	help.input = "the initial configuration ('input') or the sequence of numbers ('random').\n"
+		"The sequence can also be binary, as written by io/field_to_seq binary.";
+	help.syntax = "algo/random_throw random <number> <seed> [<logtype> [<checkpoint> <grains> <seconds>]]\n"
+		"algo/random_throw input <width> <height> [<logtype>]\n"
+		"algo/random_throw resume <checkpoint>\n"
+		"algo/random_throw ensemble <number> <seed> <replicas> <threads> [<logtype>]\n"
+		"algo/random_throw parallel <number> <seed> <threads> [<logtype>]";
+	help.add_param("(1st parameter)", "defines which of the five modes to use");
 	help.add_param("<number>", "number of random numbers to generate");
-	help.add_param("<seed>", "random seed for pseudo random number generator");
-	help.add_param("<logtype>", "'s' calculates resulting arrows, 'l' the number each arrow fires, 'n' nothing");
+	help.add_param("<seed>", "seed for the (xoshiro256**) pseudo random number generator,\n"
+		"   equal seeds give equal results on all machines. '-' picks a seed and prints it to stderr");
+	help.add_param("<logtype>", "'s' calculates resulting arrows, 'l' the number each arrow fires, 'n' nothing,\n"
+		"   'v' like 'l', but compressed,\n"
+		"   'h' histograms of avalanche size, area, waves and extent,\n"
+		"   'r' one line per avalanche: size area waves x y width height,\n"
+		"   'c' hardware counters, topples and pushes per 10.000 grains (profiling)");
+	help.add_param("<checkpoint>", "file to write checkpoints to, atomically (not for 'l', 'h' and 'c')");
+	help.add_param("<grains>, <seconds>", "write a checkpoint after this many grains or seconds, 0 means never");
 
 	MyProgram program;
 	return program.run(argc, argv, &help);
@@ -20,11 +20,14 @@
 
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
 #include <vector>
 
 #include "general.h"
 #include "io.h"
 #include "stack_algorithm.h"
+#include "varint_log.h"
+#include "drop_sequence.h"
 
 class MyProgram : public Program
 {
@@ -38,18 +41,132 @@ class MyProgram : public Program
 		 sandpile::lx_hint(grid, dim, hint, container, times);
 	}
 
+	//! relaxes after each drop, one avalanche per drop
+	template<class AvalancheContainer>
+	void start_each(std::vector<int>& grid, const dimension& dim,
+		const std::vector<int>& drops)
+	{
+		AvalancheContainer container(dim.area(), stdout);
+		sandpile::border_guard<int> guard;
+		for(const int& idx : drops)
+		{
+			grid[idx]++;
+			sandpile::l_hint(grid, dim, idx, container, guard);
+		}
+	}
+
+	//! adds all drops, then relaxes once
+	template<class Logger>
+	void start_batch(std::vector<int>& grid, const dimension& dim,
+		const std::vector<int>& drops)
+	{
+		for(const int& idx : drops)
+		 grid[idx]++;
+		sandpile::array_stack_compact container(dim.area_without_border());
+		Logger logger(stdout);
+		sandpile::fix(grid, dim, container, logger);
+		logger.write_separator();
+	}
+
+	//! reads the drops (internal indices) from a comma separated list,
+	//! or, if @a list is null, from the rest of stdin
+	void read_drops(const char* list, const dimension& dim,
+		std::vector<int>& drops)
+	{
+		const int grid_size = dim.area_without_border();
+		const auto add = [&](int index) {
+			if(!human_idx_on_grid(grid_size, index))
+			 exit("You must assert for each index i: 0 <= i < area.");
+			drops.push_back(human2internal(index, dim.width()));
+		};
+
+		if(list)
+		{
+			for(const char* ptr = list; *ptr; )
+			{
+				char* end;
+				add(strtol(ptr, &end, 10));
+				assert_usage(end != ptr && (!*end || *end == ','));
+				ptr = *end ? end + 1 : end;
+			}
+		}
+		else if(sca::io::seqfile_reader::is_binary(stdin))
+		{
+			sca::io::seqfile_reader reader(stdin);
+			if(reader.header().width != dim.width() - 2
+				|| reader.header().height != dim.height() - 2)
+			 exit("Dimension of the binary sequence does not match.");
+			uint32_t index;
+			while(reader.next(index))
+			 add(index);
+		}
+		else
+		{
+			int index;
+			while(fscanf(stdin, "%d", &index) == 1)
+			 add(index);
+		}
+	}
+
+	//! the modes 'batch' and 'each'
+	exit_t main_drops()
+	{
+		assert_usage(argc == 3 || argc == 4);
+		const bool batch = !strcmp(argv[1], "batch");
+		const char output_type = argv[2][0];
+		assert_usage(!argv[2][1] && (output_type=='l'
+			||output_type=='s'||output_type=='v'));
+
+		std::vector<int> grid;
+		dimension dim;
+		read_grid(stdin, &grid, &dim);
+		std::vector<int> drops;
+		read_drops((argc == 4) ? argv[3] : nullptr, dim, drops);
+
+		if(batch) switch(output_type)
+		{
+			case 'l':
+				start_batch<sandpile::fix_log_la>(grid, dim, drops);
+				break;
+			case 'v':
+				start_batch<sandpile::fix_log_v>(grid, dim, drops);
+				break;
+			default:
+				start_batch<sandpile::fix_log_s>(grid, dim, drops);
+		}
+		else switch(output_type)
+		{
+			case 'l':
+				start_each<sandpile::array_queue_async>(grid, dim, drops);
+				break;
+			case 'v':
+				start_each<sandpile::array_queue_varint>(grid, dim, drops);
+				break;
+			default:
+				start_each<sandpile::array_stack_compact>(grid, dim, drops);
+		}
+		if(output_type == 's')
+		 write_grid(stdout, &grid, &dim);
+		return exit_t::success;
+	}
+
 	exit_t main()
 	{
+		if(argc > 1 && (!strcmp(argv[1], "batch")
+			|| !strcmp(argv[1], "each")))
+		 return main_drops();
+
 		FILE* read_fp = stdin;
 		int hint = -1;
 		int times = -1;
-		bool avalanches = false;
+		char output_type = 's';
 
 		switch(argc) {
 			case 4: times = atoi(argv[3]);
 			case 3: hint = atoi(argv[2]);
-			case 2: assert_usage(!argv[1][1] && (argv[1][0]=='l'||argv[1][0]=='s'));
-				avalanches = (argv[1][0]=='l');
+			case 2: output_type = argv[1][0];
+				assert_usage(!argv[1][1] && (output_type=='l'
+					||output_type=='s'||output_type=='v'));
 				break;
 			default: exit_usage();
 		}
@@ -85,10 +202,12 @@ class MyProgram : public Program
 			}
 		}
 
-		if(avalanches) {
-			start<sandpile::array_queue>(grid, dim, human2internal(hint, dim.width()), times);
+		if(output_type == 'l') {
+			start<sandpile::array_queue_async>(grid, dim, human2internal(hint, dim.width()), times);
+		} else if(output_type == 'v') {
+			start<sandpile::array_queue_varint>(grid, dim, human2internal(hint, dim.width()), times);
 		} else {
-			start<sandpile::array_stack>(grid, dim, human2internal(hint, dim.width()), times);
+			start<sandpile::array_stack_compact>(grid, dim, human2internal(hint, dim.width()), times);
 			write_grid(stdout, &grid, &dim);
 		}
 		return exit_t::success;
@@ -102,11 +221,19 @@ int main(int argc, char** argv)
 		"Algorithm runs correct if every cell if only one grain is thrown.\n"
 		"More generally, if forcing all cells >= 4 only to fire once leads to\n"
 		"no cell firing twice, than the algorithm runs correctly.";
-	help.input = "input grid";
-	help.syntax = "algo/relax s|l [<hint> [times]]";
-	help.add_param("s|l", "s calculates resulting grid, l the number each cell fires");
+	help.input = "input grid; for batch and each without <drops>, followed by\n"
+		"   an empty line and the drops (as text or binary, see io/field_to_seq)";
+	help.syntax = "algo/relax s|l|v [<hint> [times]]\n"
+		"algo/relax batch|each s|l|v [<drops>]";
+	help.add_param("s|l|v", "s calculates resulting grid, l the number each cell fires,\n"
+		"   v is like l, but compressed");
 	help.add_param("<hint>", "only ensures that cell at hint will be fired");
 	help.add_param("<times>", "forces cell at <hint> to fire not more than <times> times");
+	help.add_param("batch|each", "adds a grain at each of the <drops>. batch adds all\n"
+		"   grains first, then relaxes once (runs correctly for any number of\n"
+		"   grains), l logs this as one avalanche. each relaxes after each grain,\n"
+		"   l logs one avalanche per grain");
+	help.add_param("<drops>", "comma separated list of cells, e.g. 0,4,4");
 
 	MyProgram program;
 	return program.run(argc, argv, &help);
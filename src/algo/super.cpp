@@ -30,10 +30,12 @@ class MyProgram : public Program
 {
 	exit_t main()
 	{
-		assert_usage(argc == 1);
-		grid_t grid(std::cin, 1);
+		assert_usage(argc == 1 || argc == 2);
+		const int threads = (argc == 2) ? atoi(argv[1]) : 1;
+		assert_usage(threads > 0);
+		grid_t grid(std::cin, 1, std::numeric_limits<int>::min());
 
-		sandpile::superstabilize(grid);
+		sandpile::superstabilize(grid, threads);
 		std::cout << grid;
 
 		return exit_t::success;
@@ -43,10 +45,12 @@ class MyProgram : public Program
 int main(int argc, char** argv)
 {
 	HelpStruct help;
-	help.syntax = "algo/super";
-	help.description = "Creates the superstabilization of a given configuration.";
+	help.syntax = "algo/super [<threads>]";
+	help.description = "Creates the superstabilization of a given configuration.\n"
+		"If $SCA_IDENTITY_CACHE is set, identities are cached there (see algo/id_cache).";
 	help.input = "any configuration with values >= 0";
 	help.output = "the superstabilization";
+	help.add_param("<threads>", "number of threads for stabilizing, default 1");
 
 	MyProgram p;
 	return p.run(argc, argv, &help);
@@ -0,0 +1,240 @@
+/*************************************************************************/
+/* sca toolsuite - a toolsuite to simulate cellular automata.            */
+/* Copyright (C) 2011-2014                                               */
+/* Johannes Lorenz                                                       */
+/* https://github.com/JohannesLorenz/sca-toolsuite                       */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "general.h"
+#include "random.h"
+#include "stack_algorithm.h"
+#include "drop_sequence.h"
+#include "rotor_algorithm.h"
+#include "asm_basic.h"
+
+/*
+ * All sizes and seeds are fixed, so results of two builds (or two
+ * machines) can be compared line by line, see bench/compare.
+ */
+
+//! grid for l_hint, as in section 1 of BENCHMARKS.txt
+static const dimension throw_dim(1000, 1000);
+//! grains thrown before measuring, and measured grains
+static const uint64_t throw_before = 2140000, throw_measured = 10000;
+static const uint64_t throw_seed = 42;
+
+static const dimension fix_dim(150, 150); //!< human dimension for fix
+static const dimension id_dim(200, 200); //!< for get_identity, superstabilize
+static const dimension rotor_dim(200, 200); //!< for rotor_fix
+static const int rotor_chips = 20000;
+static const uint64_t grid_seed = 7; //!< for random grids
+
+//! a human grid of dimension @a dim with random cells in 0..3
+static grid_t random_grid(const dimension& dim, uint64_t seed)
+{
+	sca_random::xoshiro256ss rng(seed);
+	grid_t grid(dim, 1);
+	for(const point& p : grid.points())
+	 grid[p] = rng.bounded(4);
+	return grid;
+}
+
+class MyProgram : public Program
+{
+	using clock = std::chrono::steady_clock;
+
+	unsigned reps = 5, warmup = 1;
+
+	//! prints median and median absolute deviation of @a prepare
+	//! followed by @a run, where only @a run is measured
+	//! @param norm all times are multiplied with it
+	void measure(const char* name, const char* unit, double norm,
+		const std::function<void()>& prepare,
+		const std::function<void()>& run)
+	{
+		std::vector<double> times;
+		for(unsigned r = 0; r < warmup + reps; ++r)
+		{
+			prepare();
+			const clock::time_point start = clock::now();
+			run();
+			const double t = std::chrono::duration<double>(
+				clock::now() - start).count() * norm;
+			if(r >= warmup)
+			 times.push_back(t);
+		}
+
+		const auto median = [](std::vector<double> v) {
+			std::sort(v.begin(), v.end());
+			const std::size_t n = v.size();
+			return (n & 1) ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+		};
+		const double med = median(times);
+		for(double& t : times)
+		 t = std::fabs(t - med);
+		printf("%s\t%s\t%u\t%.6f\t%.6f\n", name, unit, reps, med,
+			median(times));
+		fflush(stdout);
+	}
+
+	//! l_hint in the critical phase, in s per 10.000 grains
+	template<class AvalancheContainer>
+	void bench_l_hint(const char* name, const std::vector<int>& grid,
+		const sandpile::random_drops& drops)
+	{
+		std::vector<int> cur;
+		AvalancheContainer container(throw_dim.area());
+		measure(name, "s_per_10k_grains", 10000.0 / throw_measured,
+			[&]() { cur = grid; },
+			[&]() {
+				sandpile::random_drops cur_drops = drops;
+				sandpile::border_guard<int> guard;
+				unsigned idx;
+				while(cur_drops.next(idx))
+				{
+					cur[idx]++;
+					sandpile::l_hint(cur, dim_internal(throw_dim),
+						idx, container, guard);
+				}
+			});
+	}
+
+	static dimension dim_internal(const dimension& human) {
+		return dimension(human.width() + 2, human.height() + 2);
+	}
+
+	exit_t main()
+	{
+		assert_usage(argc <= 3);
+		if(argc > 1)
+		 reps = atoi(argv[1]);
+		if(argc > 2)
+		 warmup = atoi(argv[2]);
+		assert_usage(reps > 0);
+		// the cache would make get_identity() measure the disk
+		unsetenv("SCA_IDENTITY_CACHE");
+
+		puts("# name\tunit\treps\tmedian\tmad");
+
+		{
+			// bring the grid into the critical phase, unmeasured
+			const dimension dim = dim_internal(throw_dim);
+			std::vector<int> grid;
+			create_empty_grid(grid, dim);
+			sandpile::random_drops drops(throw_seed,
+				throw_before + throw_measured, dim);
+			{
+				sandpile::array_stack container(throw_dim.area());
+				sandpile::border_guard<int> guard;
+				unsigned idx;
+				for(uint64_t i = 0; i < throw_before && drops.next(idx); ++i)
+				{
+					grid[idx]++;
+					sandpile::l_hint(grid, dim, idx, container, guard);
+				}
+			}
+			bench_l_hint<sandpile::array_stack>("l_hint_array_stack",
+				grid, drops);
+			bench_l_hint<sandpile::array_queue_no_file>(
+				"l_hint_array_queue", grid, drops);
+		}
+
+		{
+			grid_t grid;
+			measure("fix", "s", 1.0,
+				[&]() { grid = grid_t(fix_dim, 1, 6); },
+				[&]() {
+					sandpile::array_stack container(fix_dim.area());
+					sandpile::fix_log_s logger(nullptr);
+					sandpile::fix(grid.data(), grid.internal_dim(),
+						container, logger);
+				});
+		}
+
+		measure("get_identity", "s", 1.0, []() {},
+			[]() { sandpile::get_identity(id_dim); });
+
+		{
+			const grid_t identity = sandpile::get_identity(id_dim);
+			grid_t grid;
+			measure("superstabilize", "s", 1.0,
+				[&]() { grid = random_grid(id_dim, grid_seed); },
+				[&]() { sandpile::superstabilize(grid, identity); });
+		}
+
+		{
+			grid_t grid, chips;
+			point center(rotor_dim.width() / 2, rotor_dim.height() / 2);
+			measure("rotor_fix", "s", 1.0,
+				[&]() {
+					grid = random_grid(rotor_dim, grid_seed);
+					chips = grid_t(rotor_dim, 1, 0);
+					chips[center] = rotor_chips;
+				},
+				[&]() {
+					sandpile::_array_stack<int> container(
+						rotor_dim.area());
+					sandpile::_fix_log_s<int> logger(nullptr);
+					rotor::rotor_fix(grid, chips, chips.index_h(center),
+						container, logger);
+				});
+		}
+
+		{
+			std::vector<rotor::packed_cell> cells;
+			point center(rotor_dim.width() / 2, rotor_dim.height() / 2);
+			grid_t grid = random_grid(rotor_dim, grid_seed),
+				chips(rotor_dim, 1, 0);
+			chips[center] = rotor_chips;
+			measure("rotor_fix_packed", "s", 1.0,
+				[&]() { cells = rotor::pack(grid, chips); },
+				[&]() {
+					sandpile::_array_stack<rotor::packed_cell*>
+						container(rotor_dim.area());
+					sandpile::_fix_log_s<int> logger(nullptr);
+					rotor::packed_rotor_fix(cells, grid.internal_dim(),
+						chips.index_h(center), container, logger);
+				});
+		}
+
+		return exit_t::success;
+	}
+};
+
+int main(int argc, char** argv)
+{
+	HelpStruct help;
+	help.description = "Benchmarks the ASM algorithms on fixed grids and seeds.\n"
+		"l_hint is measured like in section 1 of BENCHMARKS.txt: 10.000 grains\n"
+		"on a 1000x1000 grid after 2140000 grains.\n"
+		"rotor_fix_packed is rotor_fix with packed cells, without (un)packing.";
+	help.syntax = "bench/bench_asm [<repetitions> [<warmup>]]";
+	help.output = "one line per algorithm: name, unit, repetitions,\n"
+		"   median and median absolute deviation, separated by tabs";
+	help.add_param("<repetitions>", "measured runs per algorithm, default 5");
+	help.add_param("<warmup>", "unmeasured runs before, default 1");
+
+	MyProgram p;
+	return p.run(argc, argv, &help);
+}
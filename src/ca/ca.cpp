@@ -39,10 +39,14 @@ class MyProgram : public Program, sim::ulator
 		bool async = false;
 		int num_steps = INT_MAX;
 		unsigned seed = sca_random::find_good_seed();
+		int threads = 1;
 		sim_type sim = sim_type::end;
 
 		switch(argc)
 		{
+			case 7:
+				threads = atoi(argv[6]);
+				assert_usage(threads > 0);
 			case 6:
 				seed = atoi(argv[5]);
 			case 5:
@@ -71,12 +75,14 @@ class MyProgram : public Program, sim::ulator
 			std::ifstream ifs(equation + 6);
 			ca::simulator_t<ca::table_t, def_coord_traits,
 				def_cell_traits> simulator(ifs);
+			simulator.set_threads(threads);
 			result = func(simulator, sim, num_steps, async, seed);
 		}
 		else
 		{
 			ca::simulator_t<ca::eqsolver_t, def_coord_traits,
 				def_cell_traits> simulator(equation, async);
+			simulator.set_threads(threads);
 			result = func(simulator, sim, num_steps, async, seed);
 		}
 
@@ -84,7 +90,7 @@ class MyProgram : public Program, sim::ulator
 	}
 
 	template<class CaType>
-	exit_t func(ca::simulator_t<CaType,  def_coord_traits, def_cell_traits> simulator,
+	exit_t func(ca::simulator_t<CaType,  def_coord_traits, def_cell_traits>& simulator,
 		const sim_type& sim,
 		const int& num_steps,
 		const bool& async,
@@ -95,7 +101,8 @@ class MyProgram : public Program, sim::ulator
 		FILE* const in_fp = stdin;
 		FILE* const out_fp = stdout;
 
-		sca_random::set_seed(seed);
+		sca_random::set_seed(seed); // for rand() in equations
+		simulator.set_seed(seed);
 
 		switch(sim)
 		{
@@ -171,12 +178,14 @@ int main(int argc, char** argv)
 {
 	HelpStruct help;
 	help.syntax = "ca/ca <equation> "
-		"[<sim_type> [<rounds> [sync|async [seed]]]]";
+		"[<sim_type> [<rounds> [sync|async [seed [threads]]]]]";
 	help.description = "Runs a cellular automaton (ca).";
 	help.input = "start configuration of the ca";
 	help.output = "configuration after the simulation";
 	help.add_param("equation", "specifies the equation which determines the ca");
 	help.add_param("rounds", "number of rounds to simulate; if not given, simulates until stable");
+	help.add_param("seed", "seed for async rounds and rand(); runs with equal seeds are equal");
+	help.add_param("threads", "number of threads for sync rounds, default 1");
 
 	MyProgram p;
 	return p.run(argc, argv, &help);
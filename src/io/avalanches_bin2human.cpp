@@ -26,6 +26,7 @@
 #include "general.h"
 #include "geometry.h" // TODO: only for coord_t -> use types.h?
 #include "io.h"
+#include "varint_log.h"
 
 const unsigned int BUF_SIZE = 1024;
 
@@ -77,6 +78,44 @@ void parse_avalanches(FILE* in_fp, FILE* out_fp,
 	 fputs("\n",out_fp);
 }
 
+//! version for compressed logs (index size 0), see varint_log.h
+void parse_varint_avalanches(FILE* in_fp, FILE* out_fp,
+	def_coord_traits::u_coord_t width, bool ids = false)
+{
+	sandpile::varint_log_reader reader(in_fp);
+	using token_t = sandpile::varint_log_reader::token_t;
+	std::size_t avalanche_number = 1;
+	bool do_newline = true;
+	bool first_line = true;
+	int64_t idx;
+	token_t token;
+
+	while((token = reader.next(idx)) != token_t::eof)
+	{
+		if(token == token_t::separator) {
+			do_newline = true;
+			++avalanche_number;
+		}
+		else
+		{
+			if(do_newline)
+			{
+				if(first_line)
+				 first_line = false;
+				else
+				 fputs("\n", out_fp);
+				if(ids)
+				 fprintf(out_fp, "%lu",
+					avalanche_number);
+				do_newline = false;
+			}
+			fprintf(out_fp, " %u", internal2human(idx, width));
+		}
+	}
+	if(!first_line)
+	 fputs("\n",out_fp);
+}
+
 // note: we don't use an out buffer, since stdout will be buffered by \n
 // and those \n signs will occur seldom enough...
 class MyProgram : public Program
@@ -136,6 +175,9 @@ class MyProgram : public Program
 		// TODO: better use a variadic list to check for 1,2,4,8
 		switch(hdr_info.size_each)
 		{
+			case 0:
+				parse_varint_avalanches(in_fp, out_fp, width, ids);
+				break;
 			case 1:
 				parse_avalanches<int8_t>(in_fp, out_fp, width, hdr_info.div_size, hdr_info.offset, ids);
 				break;
@@ -151,7 +193,7 @@ class MyProgram : public Program
 			default:
 				assert_always(false,
 					"The avalanche index size"
-					"must be out of {1,2,4,8}.");
+					"must be out of {0,1,2,4,8}.");
 		}
 
 		return success(feof(in_fp)!=0); // feof==0 <=> stop, but no eof <=> error
@@ -163,7 +205,7 @@ int main(int argc, char** argv)
 	HelpStruct help;
 	help.description = "Converts the binary avalanche output of algorithms in algo into human readable avalanches.\n"
 		"Not efficient for large amount of data (code could be improved)";
-	help.input = "the binary avalanche data";
+	help.input = "the binary avalanche data, raw or compressed";
 	help.output = "the human readable avalanche data (a number sequence)";
 	help.syntax = "io/avalanches_bin2human <width> [ids]";
 	help.add_param("<width>", "width of grid used to compute the input data");
@@ -26,6 +26,7 @@
 
 #include "general.h"
 #include "grid.h"
+#include "io/seqfile.h"
 
 class MyProgram : public Program
 {
@@ -33,11 +34,24 @@ class MyProgram : public Program
 	{
 		FILE* read_fp=stdin;
 		char separator = ' ';
+		bool binary = false;
+		sca::io::seq_encoding encoding = sca::io::seq_encoding::raw;
 
 		switch(argc)
 		{
-			case 2: assert_usage(!strcmp(argv[1],"newlines"));
-				separator = '\n';
+			case 2:
+				if(!strcmp(argv[1],"binary"))
+				 binary = true;
+				else if(!strcmp(argv[1],"varint"))
+				{
+					binary = true;
+					encoding = sca::io::seq_encoding::varint;
+				}
+				else
+				{
+					assert_usage(!strcmp(argv[1],"newlines"));
+					separator = '\n';
+				}
 			case 1: break;
 			default: exit_usage();
 		}
@@ -47,6 +61,27 @@ class MyProgram : public Program
 
 		read_grid(read_fp, &grid, &dim);
 
+		if(binary)
+		{
+			sca::io::seq_header hdr;
+			hdr.encoding = encoding;
+			hdr.width = dim.width() - 2;
+			hdr.height = dim.height() - 2;
+			hdr.count = 0;
+			for(const int& cell : grid)
+			if(cell != INT_MIN)
+			 hdr.count += cell;
+
+			sca::io::seqfile_writer writer(stdout, hdr);
+			for(unsigned int i=0; i<grid.size(); i++)
+			{
+				const int human = internal2human(i,dim.width());
+				while(grid[i] != INT_MIN && grid[i]--)
+				 writer.write(human);
+			}
+			return exit_t::success;
+		}
+
 		for(unsigned int i=0; i<grid.size(); i++)
 		{
 			const int human = internal2human(i,dim.width());
@@ -66,8 +101,10 @@ int main(int argc, char** argv)
 		"which - added - give the specified grid. Separated by spaces.";
 	help.input = "input grid";
 	help.output = "sequence of numbers";
-	help.syntax = "io/field_to_seq [newlines]";
+	help.syntax = "io/field_to_seq [newlines|binary|varint]";
 	help.add_param("newlines", "newlines are chosen as separators, instead of spaces");
+	help.add_param("binary", "writes a binary sequence of 32 bit indices");
+	help.add_param("varint", "writes a binary sequence of delta coded varints (smaller)");
 
 	MyProgram program;
 	return program.run(argc, argv, &help);
@@ -24,6 +24,7 @@
 
 #include "general.h"
 #include "grid.h"
+#include "io/seqfile.h"
 
 class MyProgram : public Program
 {
@@ -44,6 +45,19 @@ class MyProgram : public Program
 		const int grid_size = dim.area_without_border();
 		std::vector<int> grid(dim.area());
 
+		if(sca::io::seqfile_reader::is_binary(read_fp))
+		{
+			sca::io::seqfile_reader reader(read_fp);
+			if(reader.header().width != dim.width() - 2
+				|| reader.header().height != dim.height() - 2)
+			 exit("Dimension of the binary sequence does not match.");
+			uint32_t index;
+			while(reader.next(index))
+			 grid[human2internal(index, dim.width())]++;
+			write_grid(stdout, &grid, &dim);
+			return exit_t::success;
+		}
+
 		int symbols_read;
 		int index;
 
@@ -66,7 +80,7 @@ int main(int argc, char** argv)
 	HelpStruct help;
 	help.description = "Iterates through a given sequence of numbers, adding a coordinate to\n"
 		"each such a position on a grid. Adding is meant without any stabilization.";
-	help.input = "sequence of numbers";
+	help.input = "sequence of numbers, as text or binary (see io/field_to_seq)";
 	help.output = "resulting grid";
 	help.syntax = "io/seq_to_field <width> <height>";
 	help.add_param("<width>, <height>", "specifies the desired dimension for the output grid");
@@ -23,28 +23,57 @@
 
 #include "geometry.h"
 #include "stack_algorithm.h"
+#include "parallel_fix.h"
+#include "sweep_fix.h"
+#include "least_action_fix.h"
 #include "io.h"
+#include "io/identity_cache.h"
 
 namespace sandpile
 {
 
-inline void stabilize(grid_t& grid)
+//! @param threads if > 1, parallel_fix() is used
+//! otherwise, least_action_fix() is used for grids with few large piles
+//! and sweep_fix() for grids with many grains
+inline void stabilize(grid_t& grid, unsigned threads = 1)
 {
-	// +1 is an ugly, necessary trick
-	array_stack container(grid.human_dim().area() /*+ 1*/);
-	fix_log_s logger(nullptr);
-	fix(grid.data(), grid.internal_dim(), container, logger);
+	if(threads > 1)
+	 parallel_fix(grid.data(), grid.internal_dim(), threads);
+	else if(least_action_is_faster(grid.data(), grid.internal_dim()))
+	 least_action_fix(grid.data(), grid.internal_dim());
+	else if(sweep_is_faster(grid.data(), grid.internal_dim()))
+	 sweep_fix(grid.data(), grid.internal_dim());
+	else
+	{
+		// +1 is an ugly, necessary trick
+		array_stack container(grid.human_dim().area() /*+ 1*/);
+		fix_log_s logger(nullptr);
+		fix(grid.data(), grid.internal_dim(), container, logger);
+	}
 }
 
-//! Given an empty vector @a grid, creates grid of dimension @a dim
-//! with all cells being @a predefined_value
-inline grid_t get_identity(const dimension& dim)
+//! computes the identity of the ASM group on human dimension @a dim
+inline grid_t compute_identity(const dimension& dim, unsigned threads = 1)
 {
 	grid_t grid(dim, 1, 6); // grid with every cell = 6
-	stabilize(grid);
+	stabilize(grid, threads);
 	for(def_cell_traits::cell_t& c : grid)
 	 c = 6 - c;
-	stabilize(grid);
+	stabilize(grid, threads);
+	return grid;
+}
+
+//! like compute_identity(), but looks into the identity cache first
+//! and fills it, if $SCA_IDENTITY_CACHE is set
+inline grid_t get_identity(const dimension& dim, unsigned threads = 1)
+{
+	const char* cache_dir = sca::io::identity_cache_dir();
+	grid_t grid;
+	if(cache_dir && sca::io::load_identity(cache_dir, dim, grid))
+	 return grid;
+	grid = compute_identity(dim, threads);
+	if(cache_dir)
+	 sca::io::store_identity(cache_dir, grid); // failing is no error
 	return grid;
 }
 
@@ -62,17 +91,17 @@ inline grid_t get_identity(const dimension& dim)
 
 //! calculates superstabilization of @a grid
 inline void superstabilize(grid_t& grid,
-	const grid_t& identity)
+	const grid_t& identity, unsigned threads = 1)
 {
 	assert(identity.internal_dim() == grid.internal_dim());
 
-	stabilize(grid);
+	stabilize(grid, threads);
 
 	for(const point& p : grid.points())
 	if(grid[p]>=0) // todo: necessary?
 	 grid[p] = 3 - grid[p] + identity[p];
 
-	stabilize(grid);
+	stabilize(grid, threads);
 
 	for(const point& p : grid.points())
 	 if(grid[p]>=0)
@@ -82,11 +111,86 @@ inline void superstabilize(grid_t& grid,
 }
 
 //! calculates superstabilization of @a grid
-inline void superstabilize(grid_t& grid)
+inline void superstabilize(grid_t& grid, unsigned threads = 1)
 {
-	superstabilize(grid, get_identity(grid.human_dim()));
+	superstabilize(grid, get_identity(grid.human_dim(), threads), threads);
 }
 
+/**
+	@brief Burning test, for many grids of equal dimension.
+
+	Each border cell throws one grain on each of its neighbours. The grid
+	is recurrent iff then, every cell fires (exactly once). Instead of
+	logging the avalanche, the fired cells are marked in a bitset, where
+	the border is marked from the start, so it never fires.
+	The buffers are kept between the calls, so use one object per thread.
+*/
+class burning_test
+{
+	dimension dim; //!< internal dimension of the last grid
+	std::vector<int8_t> grains;
+	std::vector<uint64_t> fired; //!< one bit per cell
+	std::vector<uint32_t> queue;
+	std::vector<uint64_t> border; //!< fired bits of the border only
+
+	bool is_fired(uint32_t i) const { return (fired[i >> 6] >> (i & 63)) & 1; }
+	static void set(std::vector<uint64_t>& bits, uint32_t i) {
+		bits[i >> 6] |= (uint64_t)1 << (i & 63);
+	}
+	void set_fired(uint32_t i) { set(fired, i); }
+
+	void resize(const dimension& new_dim)
+	{
+		dim = new_dim;
+		grains.resize(dim.area());
+		queue.resize(dim.area_without_border());
+		border.assign((dim.area() + 63) >> 6, 0);
+		for(uint32_t i = 0; i < dim.area(); ++i)
+		 if(is_border(dim, i))
+		  set(border, i);
+	}
+public:
+	//! @param grid internal grid, with border
+	//! @return true iff @a grid is stable and recurrent
+	bool operator()(const std::vector<int>& grid, const dimension& grid_dim)
+	{
+		if(!(grid_dim == dim))
+		 resize(grid_dim);
+		const uint32_t w = dim.width(), h = dim.height();
+		fired = border;
+
+		uint32_t* write = queue.data();
+		for(uint32_t y = 1; y < h - 1; ++y)
+		for(uint32_t x = 1; x < w - 1; ++x)
+		{
+			const uint32_t i = y * w + x;
+			if(grid[i] < 0 || grid[i] > 3)
+			 return false;
+			grains[i] = grid[i] + (x == 1) + (x == w - 2)
+				+ (y == 1) + (y == h - 2);
+			if(grains[i] > 3)
+			{
+				set_fired(i);
+				*(write++) = i;
+			}
+		}
+
+		// every cell fires at most once, so the queue never overflows
+		const int32_t offsets[4] = { 1, -1, (int32_t)w, -(int32_t)w };
+		for(const uint32_t* read = queue.data(); read != write; ++read)
+		for(const int32_t& o : offsets)
+		{
+			const uint32_t j = *read + o;
+			if(!is_fired(j) && ++grains[j] > 3)
+			{
+				set_fired(j);
+				*(write++) = j;
+			}
+		}
+		return write - queue.data() == dim.area_without_border();
+	}
+};
+
 }
 
 #endif // ASM_BASIC_H
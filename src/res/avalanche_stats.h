@@ -0,0 +1,187 @@
+/*************************************************************************/
+/* sca toolsuite - a toolsuite to simulate cellular automata.            */
+/* Copyright (C) 2011-2014                                               */
+/* Johannes Lorenz                                                       */
+/* https://github.com/JohannesLorenz/sca-toolsuite                       */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#ifndef AVALANCHE_STATS_H
+#define AVALANCHE_STATS_H
+
+#include <cstdio>
+#include <cstdint>
+#include <map>
+#include <vector>
+#include <algorithm>
+
+#include "stack_algorithm.h"
+
+namespace sandpile
+{
+
+//! what an _array_queue_stats writes
+enum class stats_output
+{
+	histograms, //!< histograms of all quantities, at the end
+	records //!< one line per avalanche, while running
+};
+
+/**
+	@brief Avalanche container which collects avalanche statistics.
+
+	Can be used in place of _array_queue for l_hint(), but instead of
+	logging each fired cell, it only accumulates per avalanche
+	the size (number of firings), area (number of distinct cells),
+	duration (number of 1D waves) and bounding box.
+	The overhead is one pass over each wave's queue.
+*/
+template<class T>
+class _array_queue_stats : public _array_queue_base<T>
+{
+	typedef _array_queue_base<T> base;
+
+	//! one per avalanche
+	struct record_t
+	{
+		uint64_t size = 0;
+		uint32_t area = 0, waves = 0;
+		int x0 = INT32_MAX, y0 = INT32_MAX, x1 = -1, y1 = -1;
+	};
+
+	FILE* const fp;
+	const stats_output output;
+	const int width;
+	T origin = nullptr;
+	//! stamp of the last avalanche which contained a cell
+	std::vector<uint32_t> stamp;
+	uint32_t cur_stamp = 0;
+	record_t cur;
+
+	std::map<uint64_t, uint64_t> hist_size, hist_area,
+		hist_waves, hist_extent;
+
+	static void merge_histogram(std::map<uint64_t, uint64_t>& hist,
+		const std::map<uint64_t, uint64_t>& other)
+	{
+		for(const auto& pr : other)
+		 hist[pr.first] += pr.second;
+	}
+
+	static void write_histogram(FILE* fp, const char* name,
+		const std::map<uint64_t, uint64_t>& hist)
+	{
+		fprintf(fp, "# %s\n", name);
+		for(const auto& pr : hist)
+		 fprintf(fp, "%llu %llu\n", (unsigned long long)pr.first,
+			(unsigned long long)pr.second);
+	}
+public:
+	using value_type = T;
+
+	//! @param dim internal dimension of the grid
+	inline _array_queue_stats(const dimension& dim, FILE* fp,
+		stats_output output = stats_output::histograms) :
+		base(dim.area_without_border()),
+		fp(fp),
+		output(output),
+		width(dim.width()),
+		stamp(dim.area(), 0)
+	{}
+
+	// logging:
+	inline void write_header(uint64_t grid_offset)
+	{
+		origin = (T)grid_offset;
+		cur = record_t();
+		if(!++cur_stamp) // overflow, all stamps are ambiguous now
+		{
+			std::fill(stamp.begin(), stamp.end(), 0);
+			cur_stamp = 1;
+		}
+	}
+
+	//! called after each wave, the queue holds all cells that fired
+	inline void write_to_file()
+	{
+		const T* const end = base::write_ptr + 1;
+		cur.size += end - (base::array + 1);
+		++cur.waves;
+		for(const T* p = base::array + 1; p != end; ++p)
+		{
+			const unsigned idx = *p - origin;
+			if(stamp[idx] != cur_stamp)
+			{
+				stamp[idx] = cur_stamp;
+				++cur.area;
+				const int x = idx % width, y = idx / width;
+				cur.x0 = std::min(cur.x0, x);
+				cur.x1 = std::max(cur.x1, x);
+				cur.y0 = std::min(cur.y0, y);
+				cur.y1 = std::max(cur.y1, y);
+			}
+		}
+	}
+
+	inline void write_separator()
+	{
+		const int w = cur.area ? cur.x1 - cur.x0 + 1 : 0,
+			h = cur.area ? cur.y1 - cur.y0 + 1 : 0;
+		if(output == stats_output::records)
+		{
+			// human coordinates: the border is at -1
+			fprintf(fp, "%llu %u %u %d %d %d %d\n",
+				(unsigned long long)cur.size, cur.area, cur.waves,
+				cur.area ? cur.x0 - 1 : 0, cur.area ? cur.y0 - 1 : 0,
+				w, h);
+		}
+		else
+		{
+			++hist_size[cur.size];
+			++hist_area[cur.area];
+			++hist_waves[cur.waves];
+			++hist_extent[std::max(w, h)];
+		}
+	}
+
+	inline void write_elem_to_file(const T, const uint32_t*) const {}
+
+	//! adds the histograms of @a other, e.g. of another run
+	void merge(const _array_queue_stats& other)
+	{
+		merge_histogram(hist_size, other.hist_size);
+		merge_histogram(hist_area, other.hist_area);
+		merge_histogram(hist_waves, other.hist_waves);
+		merge_histogram(hist_extent, other.hist_extent);
+	}
+
+	//! writes the histograms, if they were chosen
+	void finish() const
+	{
+		if(output == stats_output::histograms)
+		{
+			write_histogram(fp, "size", hist_size);
+			write_histogram(fp, "area", hist_area);
+			write_histogram(fp, "waves", hist_waves);
+			write_histogram(fp, "extent", hist_extent);
+		}
+	}
+};
+
+typedef _array_queue_stats<int*> array_queue_stats;
+
+}
+
+#endif // AVALANCHE_STATS_H
@@ -23,6 +23,11 @@
 #ifndef CA_H
 #define CA_H
 
+#include <algorithm>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
 #include "random.h"
 #include "ca_basics.h"
 #include "bitgrid.h"
@@ -58,14 +63,18 @@ public:
 
 	// TODO: function run_once_async()
 
+	//! activates each active cell with probability 1/2, drawing from
+	//! the simulator's generator @a rng
 	struct default_asynchronicity
 	{
-		bool operator()(unsigned ) const { return sca_random::get_int(2); }
+		bool operator()(unsigned , sca_random::xoshiro256ss& rng) const {
+			return rng.bounded(2); }
 	};
 
 	struct synchronous
 	{
-		bool operator()(unsigned ) const { return true; }
+		bool operator()(unsigned , sca_random::xoshiro256ss& ) const {
+			return true; }
 	};
 
 /*	//! runs the ca once, but only ever activating cells from @a sim_rect
@@ -132,6 +141,7 @@ class _calculator_t : public Solver
 
 public:
 	using n_t = _n_t<Traits, std::vector<point>>;
+	using scratch_t = typename Solver::scratch_t;
 
 private:
 	const u_coord_t _border_width;
@@ -182,6 +192,13 @@ public:
 		return _base::template calculate_next_state<Traits, CellTraits>(cell_ptr, p, dim, cell_tar, tar_dim);
 	}
 
+	//! like above, but reentrant if every thread uses its own @a scratch
+	int next_state(const cell_t *cell_ptr, const point& p, const dimension& dim,
+		cell_t *cell_tar, const dimension& tar_dim, scratch_t& scratch) const
+	{
+		return _base::template calculate_next_state<Traits, CellTraits>(cell_ptr, p, dim, cell_tar, tar_dim, scratch);
+	}
+
 	//! returns bitgrid
 	bool next_state(const cell_t *cell_ptr, const point& p, const dimension& dim, bitgrid_t& res) const
 	{
@@ -278,6 +295,32 @@ public:
 		return is_cell_active(grid, p, ptr);
 	}
 
+	//! returns a grid for the results of next_state() around one cell,
+	//! with the cell at out_center()
+	grid_t make_out_grid() const { return grid_t(_n_out.dim(), 0); }
+	const point& out_center() const noexcept { return cc_out; }
+
+	//! reentrant version of is_cell_active(): @a out is from
+	//! make_out_grid() and receives the next states, @a scratch is from
+	//! Solver::make_scratch(), and both must not be shared by threads
+	bool is_cell_active(const grid_t& grid, const point& p,
+		grid_t& out, scratch_t& scratch) const
+	{
+		next_state(&grid[p], p, grid.internal_dim(),
+			&out[cc_out], out.internal_dim(), scratch);
+
+		bool equal = true;
+		for(auto itr = _n_out.cbegin();
+			equal && itr != _n_out.cend(); ++itr)
+		{
+			const point grid_point = p + *itr;
+			equal = equal && (grid[grid_point] == out[cc_out + *itr]);
+			if(! grid.contains(grid_point))
+			 return false;
+		}
+		return !equal;
+	}
+
 	//! complexity: at most O(log(n))
 	bool is_state_dead(const cell_t& state) const
 	{
@@ -385,15 +428,113 @@ class simulator_t : /*private _ca_calculator_t<Solver>,*/ public input_ca
 	calc_class ca_calc;
 	input_class ca_input;
 
-	grid_t _grid[3];
+	grid_t _grid[2];
 	grid_t *old_grid = _grid, *new_grid = _grid; // TODO: old grid const?
 	typename calc_class::n_t n_in, n_out; // TODO: const?
 	std::vector<point> new_changed_cells; // TODO: vector will shrink :/
-	//! temporary variable
-	std::set<point> cells_to_check, cells_not_token; // TODO: use pointers here, like in grid
+	//! worklists, reused in every round
+	std::vector<point> candidates, cells_not_token, changed_points;
+	std::vector<unsigned> change_order;
+
+	//! state of one thread which checks cells
+	struct worker_t
+	{
+		grid_t out; //!< next states around the current cell
+		typename calc_class::scratch_t scratch;
+		//! cells that change, and their next states
+		//! (n_out.size() values per cell)
+		std::vector<point> cells;
+		std::vector<typename grid_t::value_type> next_states;
+		worker_t(const calc_class& calc) :
+			out(calc.make_out_grid()),
+			scratch(calc.make_scratch()) {}
+	};
+	std::vector<worker_t> workers;
+	unsigned threads = 1;
+	//! below, a thread is not worth starting
+	static constexpr std::size_t min_cells_per_thread = 1024;
+	//! per internal array index: the generation when the cell was
+	//! queued for checking resp. when it was reserved for writing
+	std::vector<unsigned> queued, reserved;
+	unsigned generation = 0; //!< one generation per round
+	//! all random decisions of the rounds, see set_seed()
+	sca_random::xoshiro256ss rng{0};
 	int round = 0; //!< steps since last input
 	bool async; // TODO: const?
 
+	//! starts a new generation, which invalidates all marks
+	void next_generation()
+	{
+		if(!++generation)
+		{
+			std::fill(queued.begin(), queued.end(), 0);
+			std::fill(reserved.begin(), reserved.end(), 0);
+			generation = 1;
+		}
+	}
+
+	//! returns how many threads to use for @a cells cells
+	unsigned threads_for(std::size_t cells)
+	{
+		const unsigned n = (unsigned)std::min<std::size_t>(threads,
+			std::max<std::size_t>(1, cells / min_cells_per_thread));
+		while(workers.size() < n)
+		 workers.emplace_back(ca_calc);
+		return n;
+	}
+
+	//! runs @a f(0), ..., @a f(n-1), each on its own thread
+	template<class Functor>
+	static void run_parallel(unsigned n, const Functor& f)
+	{
+		std::vector<std::thread> pool;
+		for(unsigned i = 1; i < n; ++i)
+		 pool.emplace_back(f, i);
+		f(0);
+		for(std::thread& t : pool)
+		 t.join();
+	}
+
+	//! computes the next states of the cells [first, last) and
+	//! collects the changing ones in @a w
+	//! if @a async is not synchronous, this must not run in parallel
+	template<class Asynchronicity>
+	void check_cells(worker_t& w, const point* first, const point* last,
+		const rect& sim_rect, const Asynchronicity& async)
+	{
+		const point& cc = ca_calc.out_center();
+		for(; first != last; ++first)
+		{
+			const point& p = *first;
+
+			// outputs which are not written keep their value
+			for(const point& np : n_out)
+			 w.out[cc + np] = (*old_grid)[p + np];
+
+			ca_calc.next_state(&((*old_grid)[p]),
+				p, _grid->internal_dim(),
+				&w.out[cc], w.out.internal_dim(), w.scratch);
+
+			bool active = false;
+			for(auto itr = n_out.cbegin(); !active && (itr != n_out.cend()); ++itr)
+			{
+				point ip = *itr + p;
+				active = sim_rect.is_inside(ip) && (w.out[cc + *itr] != (*old_grid)[ip]);
+			}
+
+			// note: async(2) means that active cells can be activated or not
+			// cells which are not activated stay active
+			if(active && async(2, rng))
+			{
+				w.cells.push_back(p);
+				for(const point& np : n_out)
+				 w.next_states.push_back(w.out[cc + np]);
+			}
+			else if(active)
+			 cells_not_token.push_back(p);
+		}
+	}
+
 	static constexpr const char* def_in_eq = "v:=v";
 
 	void initialize_first() { run_once(); }
@@ -404,7 +545,6 @@ public:
 		ca_calc(equation, num_states),
 		ca_input(input_equation, num_states),
 		_grid{ca_calc.border_width(),
-			ca_calc.border_width(),
 			ca_calc.border_width()},
 		n_in(ca_calc.n_in()),
 		n_out(ca_calc.n_out()),
@@ -437,6 +577,10 @@ public:
 
 	virtual ~simulator_t() {}
 
+	//! seeds the generator for the order of the cells and for the
+	//! asynchronous decisions; equal seeds give equal runs
+	void set_seed(uint64_t seed) { rng.set_seed(seed); }
+
 	// TODO: there is no virtual function right now...
 	void reset_ca(const char* equation, const char* input_equation)
 	{
@@ -445,8 +589,13 @@ public:
 		grid().resize_borders(ca_calc.border_width());
 		n_in = ca_calc.n_in();
 		n_out = ca_calc.n_out();
+		workers.clear();
 	}
 
+	//! sets the number of threads for synchronous rounds and for
+	//! finalize(); the results do not depend on it
+	void set_threads(unsigned n) { threads = n ? n : 1; }
+
 	// TODO: no function should take grid pointer
 
 	//! calculates next state at (human) position (x,y)
@@ -484,19 +633,36 @@ public:
 	{
 		// incorrect if we finalize later? (what is 0 and 1?)
 		_grid[1] = _grid[0]; // fit borders
-		_grid[2] = _grid[0], _grid[2].reset(0);
+		queued.assign(_grid[0].internal_dim().area(), 0);
+		reserved.assign(_grid[0].internal_dim().area(), 0);
+		generation = 0;
+		cells_not_token.clear();
+		changed_points.clear();
 
 		// make all cells active, but not those close to the border
 		// TODO: make this generic for arbitrary neighbourhoods
-	//	new_changed_cells.reserve(sim_rect.area());
-		for( const point &p : sim_rect ) {
-			// TODO: use active criterion if possible
-			// TODO: otherwise, invariant can be broken...
-			// TODO: (because these cells are not active)
-			//for(const point np : n_in)
-			if(ca_calc.is_cell_active(_grid[0], p))
-			 new_changed_cells.push_back(p);
-		}
+		// the rows are split into bands, one per thread
+		const unsigned parts = threads_for(sim_rect.area());
+		const typename Traits::coord_t top = sim_rect.ul().y,
+			height = sim_rect.lr().y - top;
+		run_parallel(parts, [&](unsigned i)
+		{
+			worker_t& w = workers[i];
+			w.cells.clear();
+			const _rect<Traits> band(
+				point(sim_rect.ul().x, top + height * i / parts),
+				point(sim_rect.lr().x, top + height * (i + 1) / parts));
+			for( const point &p : band ) {
+				// TODO: use active criterion if possible
+				// TODO: otherwise, invariant can be broken...
+				// TODO: (because these cells are not active)
+				if(ca_calc.is_cell_active(_grid[0], p, w.out, w.scratch))
+				 w.cells.push_back(p);
+			}
+		});
+		for(unsigned i = 0; i < parts; ++i)
+		 new_changed_cells.insert(new_changed_cells.end(),
+			workers[i].cells.begin(), workers[i].cells.end());
 
 		initialize_first();
 	}
@@ -507,6 +673,8 @@ public:
 	// TODO: function run_once_async()
 
 	//! runs the ca once, but only ever activating cells from @a sim_rect
+	//! complexity: linear in the number of cells that are checked,
+	//! independent of the grid's area
 	template<class Asynchronicity>
 	void _run_once(const rect& sim_rect,
 		const Asynchronicity& async = synchronous())
@@ -515,93 +683,96 @@ public:
 		old_grid = _grid + ((round+1)&1);
 		new_grid = _grid + ((round)&1);
 
-		cells_to_check.clear();
+		// invariant: both grids only differ where the last round wrote
+		for(const point& p : changed_points)
+		 (*new_grid)[p] = (*old_grid)[p];
+		changed_points.clear();
+
+		next_generation();
+		candidates.clear();
 
-		const auto add_cell_if_variable_and_async = [&](const point& p)
+		const auto add_cell_if_variable = [&](const point& p)
 		{
 			if(sim_rect.is_inside(p))
 			{
-				/*(*new_grid)[p] =*/ ca_calc.next_state
-					(&((*old_grid)[p]),
-						p, _grid->internal_dim(),
-						&((*new_grid)[p]), _grid->internal_dim());
-
-				bool changes = false;
-				for(auto itr = n_out.cbegin(); !changes && (itr != n_out.cend()); ++itr)
-				{
-					point ip = *itr + p;
-
-					// note: async(2) means that active cells can be activated or not
-					changes = changes || ( sim_rect.is_inside(ip) &&  ((*new_grid)[ip] != (*old_grid)[ip]) && async(2));
-					if(changes)
-					{
-						std::cout << "neq:" << ip << std::endl;
-						std::cout << (*new_grid)[ip] << " <-> " << (*old_grid)[ip] << std::endl;
-					}
-				}
-				if(changes)
+				unsigned& queued_at = queued[_grid->index_h(p)];
+				if(queued_at != generation)
 				{
-					std::cout << "FOUND ACTIVE CELL: " << p << std::endl;
-					cells_to_check.insert(p);
+					queued_at = generation;
+					candidates.push_back(p);
 				}
 			}
 		};
 
-		new_grid->reset(std::numeric_limits<int>::min());
-
 		for(const point& ap : new_changed_cells)
 		for(const point& np : n_in)
-		 add_cell_if_variable_and_async(ap + np);
+		 add_cell_if_variable(ap + np);
 		new_changed_cells.clear();
 
 		for(const point& p : cells_not_token)
-		 add_cell_if_variable_and_async(p);
+		 add_cell_if_variable(p);
 		cells_not_token.clear();
 
-	//	std::cout << "NG:" << std::endl << (*new_grid) << std::endl;
-
-		std::vector<point> change_order;
-		std::copy(cells_to_check.begin(), cells_to_check.end(), std::back_inserter(change_order));
-
-		std::random_device rd;
-		std::mt19937 g(rd());
-		std::shuffle(change_order.begin(), change_order.end(), g);
-
-		_grid[2].reset(0); // TODO: reset all?
-
-		std::set<point> final_dec;
+		// only synchronous rounds are split, since asynchronous ones
+		// draw random numbers in the order of the candidates
+		// splitting the candidate list into consecutive parts keeps
+		// the order of the results, independent of the thread number
+		const unsigned parts =
+			std::is_same<Asynchronicity, synchronous>::value
+			? threads_for(candidates.size()) : threads_for(0);
+		const std::size_t num = candidates.size();
+		run_parallel(parts, [&](unsigned i)
+		{
+			worker_t& w = workers[i];
+			w.cells.clear();
+			w.next_states.clear();
+			check_cells(w, candidates.data() + num * i / parts,
+				candidates.data() + num * (i + 1) / parts,
+				sim_rect, async);
+		});
+
+		std::vector<point>& cells_to_check = workers[0].cells;
+		std::vector<typename grid_t::value_type>& next_states
+			= workers[0].next_states;
+		for(unsigned i = 1; i < parts; ++i)
+		{
+			cells_to_check.insert(cells_to_check.end(),
+				workers[i].cells.begin(), workers[i].cells.end());
+			next_states.insert(next_states.end(),
+				workers[i].next_states.begin(),
+				workers[i].next_states.end());
+		}
 
+		// Fisher-Yates, since std::shuffle's results differ between
+		// standard libraries
+		change_order.resize(cells_to_check.size());
+		for(unsigned i = 0; i < change_order.size(); ++i)
+		{
+			const unsigned j = rng.bounded(i + 1);
+			change_order[i] = change_order[j];
+			change_order[j] = i;
+		}
 
-		// TODO: the log factor would be avoidable...
-		for(point& cp : change_order)
+		// cells whose outputs overlap with those of a cell
+		// that was taken before are retried in the next round
+		for(const unsigned idx : change_order)
 		{
+			const point& cp = cells_to_check[idx];
 			const auto point_avail = [&](const point& p){
-			//	std::cout << p << ": " << _grid[2][p] << std::endl;
-				return !_grid[2][p]; };
+				return reserved[_grid->index_h(p)] != generation; };
 			if(n_out.for_each_bool(cp, point_avail)) {
-				const auto reserve_point = [&](const point& p){ _grid[2][p] = 1; };
-				n_out.for_each(cp, reserve_point);
-				final_dec.insert(cp);
-			}
-			else {
-				std::cout << "rejected: "<< cp <<std::endl;
-				cells_not_token.insert(cp);
-				cp = point(-1, -1);
+				auto next_itr = next_states.cbegin() + idx * n_out.size();
+				n_out.for_each(cp, [&](const point& p){
+					reserved[_grid->index_h(p)] = generation;
+					(*new_grid)[p] = *(next_itr++);
+					changed_points.push_back(p);
+				});
+				new_changed_cells.push_back(cp);
 			}
+			else
+			 cells_not_token.push_back(cp);
 		}
 
-	//	std::cout << "reserved:" << _grid[2] << std::endl;
-
-		for(const point& p : sim_rect)
-		 if(final_dec.find(p) == final_dec.end())
-		  (*new_grid)[p] = (*old_grid)[p];
-		 else
-		  std::cout << "ACTIVATED: " << p << std::endl;
-
-	//	std::cout << "NOW:" <<  std::endl;
-	//	std::cout << *old_grid;
-	//	std::cout << *new_grid;
-
 		++round;
 	}
 
@@ -641,7 +812,7 @@ public:
 
 	//! returns true iff not all cells are inactive
 	bool can_run() const {
-		return (new_changed_cells.size() || async); // TODO: async condition is wrong
+		return new_changed_cells.size() || cells_not_token.size();
 	}
 
 	stable_t gets_stable() const { return stable_t::unknown; }
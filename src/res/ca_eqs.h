@@ -23,6 +23,7 @@
 
 #include <map>
 #include <stack>
+#include <vector>
 #if 0
 #include <boost/graph/graph_traits.hpp>
 #include <boost/graph/adjacency_list.hpp>
@@ -46,8 +47,14 @@ private:
 //	n_t_const neighbourhood;
 
 public:
+	//! scratch state for evaluating cells; threads which evaluate
+	//! cells at the same time need one each
+	using scratch_t = std::vector<int>;
+
 	std::size_t num_states() const noexcept { return _num_states; }
 
+	scratch_t make_scratch() const { return scratch_t(helpers_size); }
+
 	template<class Traits>
 	typename Traits::u_coord_t calc_border_width() const
 	{
@@ -128,16 +135,17 @@ public:
 	}
 
 
+	//! @param helpers the helper variables, by default the shared ones
 	template<class Src, class Tar, class T>
 	int calculate_next_state(const Src& src_array, const Tar& tar_array,
-		const _point<T>& p) const
+		const _point<T>& p, int* helpers = nullptr) const
 	{
 		// TODO: replace &((*old_grid)[internal]) by old_value
 		// and make old_value a ptr/ref?
 		using vprinter_t = eqsolver::_variable_print<Src, Tar>;
 		vprinter_t vprinter(
 			p.x, p.y,
-			src_array, tar_array, helper_vars);
+			src_array, tar_array, helpers ? helpers : helper_vars);
 		eqsolver::ast_print<vprinter_t> solver(&vprinter);
 		return (int)solver(ast);
 	}
@@ -169,6 +177,20 @@ public:
 			);
 	}
 
+	//! version for multi-targets, reentrant if every thread
+	//! uses its own @a scratch
+	template<class T, class CT>
+	int calculate_next_state(const typename CT::cell_t *cell_ptr,
+		const _point<T>& p, const _dimension<T>& dim, typename CT::cell_t *cell_tar,
+		const _dimension<T>& tar_dim, scratch_t& scratch) const
+	{
+		return calculate_next_state(
+			eqsolver::const_grid_storage_array(cell_ptr, dim.width()),
+			eqsolver::grid_storage_array(cell_tar, tar_dim.width()),
+			p, scratch.data()
+			);
+	}
+
 
 	//! Runtime: depends on formula.
 	// TODO: bit storage grids?
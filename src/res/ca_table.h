@@ -692,6 +692,20 @@ public:
 		tar_write<T, GCT>(sto, cell_tar, tar_dim);
 		return valid;
 	}
+
+	//! the table is never written, so no scratch state is needed
+	struct scratch_t {};
+	scratch_t make_scratch() const { return scratch_t(); }
+
+	//! version for multi-targets, reentrant
+	template<class T, class GCT>
+	bool calculate_next_state(const typename GCT::cell_t *cell_ptr,
+		const _point<T>& p, const _dimension<T>& dim, typename GCT::cell_t *cell_tar,
+		const _dimension<T>& tar_dim, scratch_t& ) const
+	{
+		return calculate_next_state<T, GCT>(cell_ptr, p, dim,
+			cell_tar, tar_dim);
+	}
 };
 
 /*
@@ -0,0 +1,117 @@
+/*************************************************************************/
+/* sca toolsuite - a toolsuite to simulate cellular automata.            */
+/* Copyright (C) 2011-2014                                               */
+/* Johannes Lorenz                                                       */
+/* https://github.com/JohannesLorenz/sca-toolsuite                       */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#ifndef DROP_SEQUENCE_H
+#define DROP_SEQUENCE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "random.h"
+#include "io.h"
+#include "io/seqfile.h"
+
+namespace sandpile
+{
+
+/*
+ * drop sequences: sources for positions where grains are thrown
+ * next() returns false at the end, otherwise it sets the internal index
+ * remaining() returns the number of drops left
+ */
+
+//! drop sequence stored in a vector of internal indices
+class vector_drops
+{
+	const std::vector<int>& seq;
+	std::size_t pos = 0;
+public:
+	vector_drops(const std::vector<int>& seq) : seq(seq) {}
+	uint64_t remaining() const { return seq.size() - pos; }
+	inline bool next(unsigned& idx)
+	{
+		if(pos == seq.size())
+		 return false;
+		idx = seq[pos++];
+		return true;
+	}
+};
+
+//! uniformly distributed drop sequence, generated on the fly
+//! only depends on the seed, the number and the dimension
+class random_drops
+{
+	sca_random::xoshiro256ss rng;
+	uint64_t left;
+	const uint32_t area;
+	const int width;
+public:
+	//! @param dim internal dimension
+	random_drops(uint64_t seed, uint64_t number, const dimension& dim) :
+		rng(seed),
+		left(number),
+		area(dim.area_without_border()),
+		width(dim.width())
+	{}
+	//! continues with the state @a rng, e.g. from a checkpoint
+	random_drops(const sca_random::xoshiro256ss& rng, uint64_t number,
+		const dimension& dim) :
+		rng(rng),
+		left(number),
+		area(dim.area_without_border()),
+		width(dim.width())
+	{}
+	const sca_random::xoshiro256ss& generator() const { return rng; }
+	uint64_t remaining() const { return left; }
+	inline bool next(unsigned& idx)
+	{
+		if(!left)
+		 return false;
+		--left;
+		idx = human2internal(rng.bounded(area), width);
+		return true;
+	}
+};
+
+//! drop sequence read from a binary sequence file
+class seqfile_drops
+{
+	sca::io::seqfile_reader& reader;
+	const int width;
+public:
+	//! @param dim internal dimension, must match the file's header
+	seqfile_drops(sca::io::seqfile_reader& reader, const dimension& dim) :
+		reader(reader),
+		width(dim.width())
+	{}
+	uint64_t remaining() const { return reader.remaining(); }
+	inline bool next(unsigned& idx)
+	{
+		uint32_t human;
+		if(!reader.next(human))
+		 return false;
+		idx = human2internal(human, width);
+		return true;
+	}
+};
+
+}
+
+#endif // DROP_SEQUENCE_H
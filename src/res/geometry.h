@@ -51,7 +51,8 @@ struct _point
 	constexpr _point(coord_t _x, coord_t _y) noexcept(coord_t(coord_t())) :
 		x(_x), y(_y) {}
 	_point() {}
-	constexpr _point(const _point& other) : x(other.x), y(other.y) {}
+	constexpr _point(const _point& other) = default;
+	_point& operator=(const _point& other) = default;
 	void set(int _x, int _y) { x = _x; y = _y; }
 	bool operator<(const _point& rhs) const {
 		return (y==rhs.y)?(x<rhs.x):(y<rhs.y);
@@ -124,13 +125,8 @@ struct _point_itr
 	point min, max;
 	point position;
 public:
-	_point_itr& operator=(const _point_itr& other)
-	{
-		min = other.min;
-		max = other.max;
-		position = other.position;
-		return *this;
-	}
+	_point_itr(const _point_itr& other) = default;
+	_point_itr& operator=(const _point_itr& other) = default;
 
 	_point_itr(point max, point min, point position) :
 		min(min), max(max), position(position)
@@ -0,0 +1,235 @@
+/*************************************************************************/
+/* sca toolsuite - a toolsuite to simulate cellular automata.            */
+/* Copyright (C) 2011-2014                                               */
+/* Johannes Lorenz                                                       */
+/* https://github.com/JohannesLorenz/sca-toolsuite                       */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#ifndef GROWING_GRID_H
+#define GROWING_GRID_H
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "grid.h"
+
+namespace sandpile
+{
+
+/**
+	@brief Unbounded grid, allocated in square tiles on first touch.
+
+	Each tile has 2^TileBits x 2^TileBits row-major cells, which start
+	as T(). Memory scales with the touched area, and since tiles are
+	never moved, growing never copies anything. Each tile links its
+	four neighbour tiles, so walking to a neighbour cell does not look
+	up the tile map. Coordinates can be negative.
+*/
+template<class T, unsigned TileBits = 6>
+class growing_grid
+{
+public:
+	static constexpr int side = 1 << TileBits;
+	static constexpr int mask = side - 1;
+
+	enum direction { north, east, south, west };
+
+	struct tile
+	{
+		T cells[side * side];
+		tile* neighbours[4] = {}; //!< indexed by direction
+		const int tx, ty; //!< tile coordinates
+		tile(int tx, int ty) : cells(), tx(tx), ty(ty) {}
+	};
+
+	//! a cell, given by its tile and its index in the tile
+	struct cell_ref
+	{
+		tile* t;
+		uint32_t i;
+		T& operator*() const { return t->cells[i]; }
+	};
+private:
+	std::unordered_map<uint64_t, std::unique_ptr<tile>> tiles;
+
+	static uint64_t key(int tx, int ty) {
+		return ((uint64_t)(uint32_t)tx << 32) | (uint32_t)ty;
+	}
+
+	tile* find(int tx, int ty) const
+	{
+		const auto itr = tiles.find(key(tx, ty));
+		return (itr == tiles.end()) ? nullptr : itr->second.get();
+	}
+
+	tile* create(int tx, int ty)
+	{
+		tile* const t = new tile(tx, ty);
+		tiles[key(tx, ty)].reset(t);
+		const int dx[4] = { 0, 1, 0, -1 }, dy[4] = { -1, 0, 1, 0 };
+		for(int d = north; d <= west; ++d)
+		if(tile* const n = find(tx + dx[d], ty + dy[d]))
+		{
+			t->neighbours[d] = n;
+			n->neighbours[(d + 2) & 3] = t;
+		}
+		return t;
+	}
+
+	tile* get_tile(int tx, int ty)
+	{
+		tile* const t = find(tx, ty);
+		return t ? t : create(tx, ty);
+	}
+
+	tile* neighbour(tile* t, int d)
+	{
+		if(!t->neighbours[d])
+		{
+			const int dx[4] = { 0, 1, 0, -1 }, dy[4] = { -1, 0, 1, 0 };
+			create(t->tx + dx[d], t->ty + dy[d]);
+		}
+		return t->neighbours[d];
+	}
+public:
+	//! the cell at @a x, @a y, allocating its tile if necessary
+	cell_ref at(int x, int y) {
+		return { get_tile(x >> TileBits, y >> TileBits),
+			(uint32_t)(((y & mask) << TileBits) | (x & mask)) };
+	}
+
+	//! the cell at @a x, @a y, or T() if it has never been touched
+	T get(int x, int y) const
+	{
+		const tile* const t = find(x >> TileBits, y >> TileBits);
+		return t ? t->cells[((y & mask) << TileBits) | (x & mask)] : T();
+	}
+
+	//! the neighbour of @a c in direction @a d, allocating if necessary
+	inline cell_ref step(const cell_ref& c, int d)
+	{
+		switch(d)
+		{
+			case north: return (c.i >> TileBits)
+				? cell_ref{ c.t, c.i - side }
+				: cell_ref{ neighbour(c.t, d), c.i + side * mask };
+			case east: return ((c.i & mask) != mask)
+				? cell_ref{ c.t, c.i + 1 }
+				: cell_ref{ neighbour(c.t, d), c.i - mask };
+			case south: return ((c.i >> TileBits) != mask)
+				? cell_ref{ c.t, c.i + side }
+				: cell_ref{ neighbour(c.t, d), c.i - side * mask };
+			default: return (c.i & mask)
+				? cell_ref{ c.t, c.i - 1 }
+				: cell_ref{ neighbour(c.t, d), c.i + mask };
+		}
+	}
+
+	std::size_t num_tiles() const { return tiles.size(); }
+
+	/**
+		Computes the smallest rectangle containing all cells which are
+		not T().
+		@return false if there are none
+	*/
+	bool bounding_box(point& min, point& max) const
+	{
+		bool found = false;
+		for(const auto& pr : tiles)
+		{
+			const tile& t = *pr.second;
+			for(int i = 0; i < side * side; ++i)
+			if(t.cells[i] != T())
+			{
+				const point p(t.tx * side + (i & mask),
+					t.ty * side + (i >> TileBits));
+				if(!found)
+				 min = max = p;
+				min.x = std::min(min.x, p.x);
+				min.y = std::min(min.y, p.y);
+				max.x = std::max(max.x, p.x);
+				max.y = std::max(max.y, p.y);
+				found = true;
+			}
+		}
+		return found;
+	}
+
+	//! copies the cells from @a min on into @a grid, which has a border
+	void to_grid(const point& min, grid_t& grid) const
+	{
+		for(const point& p : grid.points())
+		 grid[p] = get(min.x + p.x, min.y + p.y);
+	}
+};
+
+/**
+	Like fix() with a hint, but on a growing_grid, so grains can never
+	get lost on a border.
+	The stack grows with the avalanche, as the area is unknown.
+*/
+template<unsigned TileBits>
+inline void fix(growing_grid<int, TileBits>& grid, int x, int y)
+{
+	using cell_ref = typename growing_grid<int, TileBits>::cell_ref;
+	constexpr uint32_t side = growing_grid<int, TileBits>::side;
+	constexpr uint32_t mask = growing_grid<int, TileBits>::mask;
+	const int INVERT_BIT = std::numeric_limits<int>::min();
+	const int GRAIN_BITS = std::numeric_limits<int>::max();
+
+	std::vector<cell_ref> stack;
+	const cell_ref hint = grid.at(x, y);
+	if(*hint <= 3)
+	 return;
+	*hint |= INVERT_BIT;
+	stack.push_back(hint);
+
+	do
+	{
+		const cell_ref cur = stack.back();
+		stack.pop_back();
+
+		*cur &= GRAIN_BITS;
+		const int fire_times = *cur >> 2;
+		*cur -= (fire_times << 2);
+
+		const auto add = [&](const cell_ref& n) {
+			if((*n += fire_times) > 3) {
+				*n |= INVERT_BIT;
+				stack.push_back(n);
+			}
+		};
+		const uint32_t lx = cur.i & mask, ly = cur.i >> TileBits;
+		if(lx && lx != mask && ly && ly != mask)
+		{ // all neighbours are in the same tile
+			add({ cur.t, cur.i + 1 });
+			add({ cur.t, cur.i - 1 });
+			add({ cur.t, cur.i + side });
+			add({ cur.t, cur.i - side });
+		}
+		else
+		 for(int d = 0; d < 4; ++d)
+		  add(grid.step(cur, d));
+	} while( ! stack.empty() );
+}
+
+}
+
+#endif // GROWING_GRID_H
@@ -164,6 +164,7 @@ bool get_input(const char* shell_command)
 
 	close(pipefd[1]); /* Close unused write end */
 	dup2(pipefd[0], STDIN_FILENO);
+	clearerr(stdin); // the old stdin may have been read until eof
 	return true;
 }
 
@@ -0,0 +1,83 @@
+/*************************************************************************/
+/* sca toolsuite - a toolsuite to simulate cellular automata.            */
+/* Copyright (C) 2011-2014                                               */
+/* Johannes Lorenz                                                       */
+/* https://github.com/JohannesLorenz/sca-toolsuite                       */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#include <chrono>
+
+#include "async_writer.h"
+
+namespace sca { namespace io {
+
+async_writer::async_writer(FILE* fp) :
+	fp(fp),
+	head(0),
+	tail(0),
+	done(false)
+{
+	for(std::vector<char>& buf : buffers)
+	 buf.resize(buffer_size);
+	cur = buffers[0].data();
+	thread = std::thread(&async_writer::run, this);
+}
+
+async_writer::~async_writer()
+{
+	if(cur_fill)
+	 submit();
+	done.store(true, std::memory_order_release);
+	thread.join();
+	fflush(fp);
+}
+
+void async_writer::submit()
+{
+	const std::size_t t = tail.load(std::memory_order_relaxed);
+	fill[t % ring_size] = cur_fill;
+	tail.store(t + 1, std::memory_order_release);
+
+	// the next buffer must have been written out
+	while(t + 1 - head.load(std::memory_order_acquire) == ring_size)
+	 std::this_thread::yield();
+	cur = buffers[(t + 1) % ring_size].data();
+	cur_fill = 0;
+}
+
+void async_writer::run()
+{
+	for(;;)
+	{
+		const std::size_t h = head.load(std::memory_order_relaxed);
+		if(h == tail.load(std::memory_order_acquire))
+		{
+			// read done first, so no buffer submitted before is missed
+			if(done.load(std::memory_order_acquire)
+				&& h == tail.load(std::memory_order_acquire))
+			 return;
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+		}
+		else
+		{
+			fwrite(buffers[h % ring_size].data(), 1,
+				fill[h % ring_size], fp);
+			head.store(h + 1, std::memory_order_release);
+		}
+	}
+}
+
+}}
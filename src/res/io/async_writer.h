@@ -0,0 +1,84 @@
+/*************************************************************************/
+/* sca toolsuite - a toolsuite to simulate cellular automata.            */
+/* Copyright (C) 2011-2014                                               */
+/* Johannes Lorenz                                                       */
+/* https://github.com/JohannesLorenz/sca-toolsuite                       */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#ifndef ASYNC_WRITER_H
+#define ASYNC_WRITER_H
+
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace sca { namespace io {
+
+/**
+	@brief Writes to a FILE* from a separate thread.
+
+	Data is collected in large buffers. Full buffers are passed to the
+	writer thread through a single producer single consumer ring, so
+	the calling thread only waits if the ring is full.
+	Not thread safe: only one thread may call write().
+*/
+class async_writer
+{
+	static constexpr std::size_t buffer_size = 1 << 20;
+	static constexpr std::size_t ring_size = 4;
+
+	FILE* const fp;
+	std::vector<char> buffers[ring_size];
+	std::size_t fill[ring_size];
+	//! number of buffers written (consumer) and submitted (producer)
+	std::atomic<std::size_t> head, tail;
+	std::atomic<bool> done;
+	char* cur; //!< buffer being filled, owned by the producer
+	std::size_t cur_fill = 0;
+	std::thread thread;
+
+	void run();
+	void submit();
+public:
+	async_writer(FILE* fp);
+	//! writes out everything and joins the writer thread
+	~async_writer();
+	async_writer(const async_writer&) = delete;
+
+	//! like fwrite(), but always succeeds
+	inline void write(const void* ptr, std::size_t size, std::size_t n)
+	{
+		const char* src = (const char*)ptr;
+		std::size_t bytes = size * n;
+		while(cur_fill + bytes > buffer_size)
+		{
+			const std::size_t part = buffer_size - cur_fill;
+			memcpy(cur + cur_fill, src, part);
+			cur_fill = buffer_size;
+			src += part;
+			bytes -= part;
+			submit();
+		}
+		memcpy(cur + cur_fill, src, bytes);
+		cur_fill += bytes;
+	}
+};
+
+}}
+
+#endif // ASYNC_WRITER_H
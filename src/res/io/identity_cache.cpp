@@ -0,0 +1,114 @@
+/*************************************************************************/
+/* sca toolsuite - a toolsuite to simulate cellular automata.            */
+/* Copyright (C) 2011-2014                                               */
+/* Johannes Lorenz                                                       */
+/* https://github.com/JohannesLorenz/sca-toolsuite                       */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "identity_cache.h"
+#include "checksum.h"
+
+namespace sca { namespace io {
+
+static const char id_magic[8] = { 'S', 'C', 'A', 'I', 'D', '0', '1', '\n' };
+
+static void put_le(std::vector<uint8_t>& buf, uint64_t val, int bytes)
+{
+	for(int i = 0; i < bytes; ++i, val >>= 8)
+	 buf.push_back((uint8_t)val);
+}
+
+static uint64_t get_le(const uint8_t* src, int bytes)
+{
+	uint64_t val = 0;
+	for(int i = bytes - 1; i >= 0; --i)
+	 val = (val << 8) | src[i];
+	return val;
+}
+
+static std::string entry_name(const char* dir, const dimension& dim)
+{
+	return std::string(dir) + "/id_" + std::to_string(dim.width())
+		+ "x" + std::to_string(dim.height()) + ".bin";
+}
+
+const char* identity_cache_dir()
+{
+	const char* dir = getenv("SCA_IDENTITY_CACHE");
+	return (dir && *dir) ? dir : nullptr;
+}
+
+bool load_identity(const char* dir, const dimension& dim, grid_t& grid)
+{
+	FILE* fp = fopen(entry_name(dir, dim).c_str(), "rb");
+	if(!fp)
+	 return false;
+
+	const std::size_t area = dim.area();
+	std::vector<uint8_t> buf(8 + 4 + 4 + area + 8);
+	const bool complete = fread(buf.data(), 1, buf.size(), fp) == buf.size()
+		&& getc(fp) == EOF;
+	fclose(fp);
+
+	const uint8_t* const cells = buf.data() + 16;
+	if(!complete
+		|| memcmp(buf.data(), id_magic, 8)
+		|| get_le(buf.data() + 8, 4) != dim.width()
+		|| get_le(buf.data() + 12, 4) != dim.height()
+		|| get_le(cells + area, 8) != fnv1a(buf.data(), 16 + area))
+	 return false;
+
+	grid = grid_t(dim, 1);
+	std::size_t i = 0;
+	for(auto& c : grid)
+	 c = cells[i++];
+	return true;
+}
+
+bool store_identity(const char* dir, const grid_t& identity)
+{
+	const dimension dim = identity.human_dim();
+	std::vector<uint8_t> buf(id_magic, id_magic + 8);
+	put_le(buf, dim.width(), 4);
+	put_le(buf, dim.height(), 4);
+	for(const auto& c : identity)
+	 buf.push_back((uint8_t)c);
+	put_le(buf, fnv1a(buf.data(), buf.size()), 8);
+
+	// write a temporary file, then rename, so readers never see
+	// partial entries
+	const std::string name = entry_name(dir, dim);
+	const std::string tmp_name = name + ".tmp" + std::to_string(getpid());
+	FILE* fp = fopen(tmp_name.c_str(), "wb");
+	if(!fp)
+	 return false;
+	const bool ok = fwrite(buf.data(), 1, buf.size(), fp) == buf.size();
+	if(fclose(fp) || !ok || rename(tmp_name.c_str(), name.c_str()))
+	{
+		remove(tmp_name.c_str());
+		return false;
+	}
+	return true;
+}
+
+}}
@@ -0,0 +1,53 @@
+/*************************************************************************/
+/* sca toolsuite - a toolsuite to simulate cellular automata.            */
+/* Copyright (C) 2011-2014                                               */
+/* Johannes Lorenz                                                       */
+/* https://github.com/JohannesLorenz/sca-toolsuite                       */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#ifndef IDENTITY_CACHE_H
+#define IDENTITY_CACHE_H
+
+#include "grid.h"
+
+namespace sca { namespace io {
+
+/*
+ * on-disk cache of ASM identities
+ *
+ * one file "id_<width>x<height>.bin" per dimension:
+ *   8 bytes  magic "SCAID01\n"
+ *   4 bytes  human width, little endian
+ *   4 bytes  human height, little endian
+ *   ...      one byte per cell, row by row
+ *   8 bytes  FNV-1a checksum over all previous bytes
+ */
+
+//! returns the cache directory from $SCA_IDENTITY_CACHE,
+//! or nullptr if caching is disabled
+const char* identity_cache_dir();
+
+//! reads the identity for human dimension @a dim from @a dir
+//! @return true iff a valid entry was found and stored in @a grid
+bool load_identity(const char* dir, const dimension& dim, grid_t& grid);
+
+//! stores @a identity in @a dir, replacing the entry atomically
+//! @return false on IO errors
+bool store_identity(const char* dir, const grid_t& identity);
+
+}}
+
+#endif // IDENTITY_CACHE_H
@@ -0,0 +1,165 @@
+/*************************************************************************/
+/* sca toolsuite - a toolsuite to simulate cellular automata.            */
+/* Copyright (C) 2011-2014                                               */
+/* Johannes Lorenz                                                       */
+/* https://github.com/JohannesLorenz/sca-toolsuite                       */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "seqfile.h"
+
+namespace sca { namespace io {
+
+static const char seq_magic[8] = { '\x89', 'S', 'C', 'A', 'S', 'E', 'Q', '\n' };
+static const uint8_t seq_version = 1;
+static const std::size_t seq_header_size = 8 + 1 + 1 + 4 + 4 + 8;
+
+static void put_le(uint8_t* dest, uint64_t val, int bytes) {
+	for(int i = 0; i < bytes; ++i, val >>= 8)
+	 dest[i] = (uint8_t)val;
+}
+
+static uint64_t get_le(const uint8_t* src, int bytes) {
+	uint64_t val = 0;
+	for(int i = bytes - 1; i >= 0; --i)
+	 val = (val << 8) | src[i];
+	return val;
+}
+
+seqfile_writer::seqfile_writer(FILE* fp, const seq_header& hdr) :
+	fp(fp),
+	encoding(hdr.encoding)
+{
+	uint8_t buf[seq_header_size];
+	memcpy(buf, seq_magic, 8);
+	buf[8] = seq_version;
+	buf[9] = (uint8_t)hdr.encoding;
+	put_le(buf + 10, hdr.width, 4);
+	put_le(buf + 14, hdr.height, 4);
+	put_le(buf + 18, hdr.count, 8);
+	fwrite(buf, sizeof(buf), 1, fp);
+}
+
+void seqfile_writer::write(uint32_t human_idx)
+{
+	uint8_t buf[10];
+	if(encoding == seq_encoding::raw)
+	{
+		put_le(buf, human_idx, 4);
+		fwrite(buf, 4, 1, fp);
+	}
+	else
+	{
+		const int64_t delta = (int64_t)human_idx - last;
+		uint64_t zz = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+		int len = 0;
+		for(; zz >= 0x80; zz >>= 7)
+		 buf[len++] = (uint8_t)(zz | 0x80);
+		buf[len++] = (uint8_t)zz;
+		fwrite(buf, len, 1, fp);
+		last = human_idx;
+	}
+}
+
+bool seqfile_reader::is_binary(FILE* fp)
+{
+	const int c = getc(fp);
+	if(c == EOF)
+	 return false;
+	ungetc(c, fp);
+	return c == (uint8_t)seq_magic[0];
+}
+
+seqfile_reader::seqfile_reader(FILE* fp)
+{
+	struct stat st;
+	const int fd = fileno(fp);
+	const long offset = ftell(fp);
+	if(!fstat(fd, &st) && S_ISREG(st.st_mode) && offset >= 0
+		&& st.st_size > offset)
+	{
+		// map from the beginning, since offset must be page aligned
+		map_size = st.st_size;
+		map = mmap(nullptr, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(map == MAP_FAILED)
+		 throw "Could not map binary sequence";
+		madvise(map, map_size, MADV_SEQUENTIAL);
+		ptr = (const uint8_t*)map + offset;
+		end = (const uint8_t*)map + map_size;
+	}
+	else
+	{
+		buffer.resize(1 << 16);
+		in = fp;
+		ptr = end = buffer.data();
+		refill();
+	}
+
+	if((std::size_t)(end - ptr) < seq_header_size
+		|| memcmp(ptr, seq_magic, 8))
+	 throw "Not a binary sequence";
+	if(ptr[8] != seq_version)
+	 throw "Unsupported binary sequence version";
+	if(ptr[9] > (uint8_t)seq_encoding::varint)
+	 throw "Unknown binary sequence encoding";
+	hdr.encoding = (seq_encoding)ptr[9];
+	hdr.width = get_le(ptr + 10, 4);
+	hdr.height = get_le(ptr + 14, 4);
+	hdr.count = get_le(ptr + 18, 8);
+	ptr += seq_header_size;
+	left = hdr.count;
+}
+
+seqfile_reader::~seqfile_reader()
+{
+	if(map)
+	 munmap(map, map_size);
+}
+
+void seqfile_reader::refill()
+{
+	const std::size_t rest = end - ptr;
+	memmove(buffer.data(), ptr, rest);
+	std::size_t filled = rest, n = 1;
+	while(filled < buffer.size() && (n = fread(buffer.data() + filled,
+		1, buffer.size() - filled, in)))
+	 filled += n;
+	if(!n)
+	 in = nullptr;
+	ptr = buffer.data();
+	end = ptr + filled;
+}
+
+uint64_t seqfile_reader::read_varint()
+{
+	uint64_t val = 0;
+	for(int shift = 0; shift < 64; shift += 7)
+	{
+		if(ptr == end)
+		 throw "Binary sequence is truncated";
+		const uint8_t byte = *(ptr++);
+		val |= (uint64_t)(byte & 0x7f) << shift;
+		if(!(byte & 0x80))
+		 return val;
+	}
+	throw "Corrupt varint in binary sequence";
+}
+
+}}
@@ -0,0 +1,138 @@
+/*************************************************************************/
+/* sca toolsuite - a toolsuite to simulate cellular automata.            */
+/* Copyright (C) 2011-2014                                               */
+/* Johannes Lorenz                                                       */
+/* https://github.com/JohannesLorenz/sca-toolsuite                       */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#ifndef SEQFILE_H
+#define SEQFILE_H
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+
+namespace sca { namespace io {
+
+/*
+ * binary drop sequences
+ *
+ * layout (all numbers little endian):
+ *   8 bytes  magic "\x89SCASEQ\n" (the first byte is never text)
+ *   1 byte   version (1)
+ *   1 byte   encoding (see seq_encoding)
+ *   4 bytes  human width
+ *   4 bytes  human height
+ *   8 bytes  number of indices
+ *   ...      the human indices
+ */
+
+enum class seq_encoding : uint8_t
+{
+	raw = 0, //!< each index as uint32
+	varint = 1 //!< zigzag LEB128 varint of the delta to the last index
+};
+
+struct seq_header
+{
+	seq_encoding encoding;
+	uint32_t width, height;
+	uint64_t count;
+};
+
+//! writes a binary drop sequence. the number of indices must be known
+//! in advance
+class seqfile_writer
+{
+	FILE* const fp;
+	const seq_encoding encoding;
+	uint32_t last = 0;
+public:
+	seqfile_writer(FILE* fp, const seq_header& hdr);
+	void write(uint32_t human_idx);
+};
+
+/**
+	@brief Reads a binary drop sequence.
+
+	Regular files are memory mapped, other files (e.g. pipes)
+	are read in chunks into a buffer of fixed size.
+*/
+class seqfile_reader
+{
+	//! no index takes more bytes (varint of a 64 bit value)
+	static constexpr std::ptrdiff_t max_index_size = 10;
+
+	seq_header hdr;
+	std::vector<uint8_t> buffer; //!< only used if mmap is not possible
+	FILE* in = nullptr; //!< set while the buffer can be refilled
+	void* map = nullptr;
+	std::size_t map_size = 0;
+	const uint8_t *ptr, *end;
+	uint64_t left;
+	uint32_t last = 0;
+
+	//! moves the unread bytes to the front of the buffer and fills
+	//! the rest from the input
+	void refill();
+	//! @throws const char* on corrupt input
+	uint64_t read_varint();
+public:
+	//! returns whether @a fp starts with a binary sequence
+	//! no input is consumed
+	static bool is_binary(FILE* fp);
+
+	//! @param fp file to read, starting at its current position
+	seqfile_reader(FILE* fp);
+	~seqfile_reader();
+	seqfile_reader(const seqfile_reader&) = delete;
+
+	const seq_header& header() const { return hdr; }
+	//! number of indices which were not read yet
+	uint64_t remaining() const { return left; }
+
+	//! @return false at the end of the sequence
+	inline bool next(uint32_t& human_idx)
+	{
+		if(!left)
+		 return false;
+		--left;
+		if(in && end - ptr < max_index_size)
+		 refill();
+		if(hdr.encoding == seq_encoding::raw)
+		{
+			if(end - ptr < 4)
+			 throw "Binary sequence is truncated";
+			human_idx = (uint32_t)ptr[0] | ((uint32_t)ptr[1] << 8)
+				| ((uint32_t)ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+			ptr += 4;
+		}
+		else
+		{
+			const uint64_t zz = read_varint();
+			last += (uint32_t)((zz >> 1) ^ -(zz & 1));
+			human_idx = last;
+		}
+		if(human_idx >= (uint64_t)hdr.width * hdr.height)
+		 throw "Index in binary sequence is out of the grid";
+		return true;
+	}
+};
+
+}}
+
+#endif // SEQFILE_H
@@ -0,0 +1,121 @@
+/*************************************************************************/
+/* sca toolsuite - a toolsuite to simulate cellular automata.            */
+/* Copyright (C) 2011-2014                                               */
+/* Johannes Lorenz                                                       */
+/* https://github.com/JohannesLorenz/sca-toolsuite                       */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+#include "throw_checkpoint.h"
+#include "checksum.h"
+
+namespace sca { namespace io {
+
+static const char ckpt_magic[8] = { 'S', 'C', 'A', 'C', 'K', 'P', 'T', '1' };
+
+template<class T>
+static void put(std::vector<uint8_t>& buf, const T& val)
+{
+	const uint8_t* ptr = (const uint8_t*)&val;
+	buf.insert(buf.end(), ptr, ptr + sizeof(T));
+}
+
+template<class T>
+static void get(const uint8_t*& ptr, const uint8_t* end, T& val)
+{
+	if(end - ptr < (std::ptrdiff_t)sizeof(T))
+	 throw "Checkpoint is truncated";
+	memcpy(&val, ptr, sizeof(T));
+	ptr += sizeof(T);
+}
+
+bool throw_checkpoint::write(const char* filename) const
+{
+	std::vector<uint8_t> buf(ckpt_magic, ckpt_magic + 8);
+	put(buf, width);
+	put(buf, height);
+	put(buf, number);
+	put(buf, done);
+	put(buf, seed);
+	for(const uint64_t& s : rng_state)
+	 put(buf, s);
+	put(buf, log_type);
+	put(buf, log_offset);
+	put(buf, log_state);
+	put(buf, every_grains);
+	put(buf, every_seconds);
+	const uint8_t* cells = (const uint8_t*)grid.data();
+	buf.insert(buf.end(), cells, cells + grid.size() * sizeof(int32_t));
+	put(buf, fnv1a(buf.data(), buf.size()));
+
+	const std::string tmp_name = std::string(filename) + ".tmp";
+	FILE* fp = fopen(tmp_name.c_str(), "wb");
+	if(!fp)
+	 return false;
+	const bool ok = fwrite(buf.data(), 1, buf.size(), fp) == buf.size()
+		&& !fflush(fp) && !fsync(fileno(fp));
+	if(fclose(fp) || !ok || rename(tmp_name.c_str(), filename))
+	{
+		remove(tmp_name.c_str());
+		return false;
+	}
+	return true;
+}
+
+void throw_checkpoint::read(const char* filename)
+{
+	FILE* fp = fopen(filename, "rb");
+	if(!fp)
+	 throw "Could not open checkpoint";
+	std::vector<uint8_t> buf;
+	uint8_t chunk[1 << 16];
+	std::size_t n;
+	while((n = fread(chunk, 1, sizeof(chunk), fp)))
+	 buf.insert(buf.end(), chunk, chunk + n);
+	fclose(fp);
+
+	if(buf.size() < 8 + sizeof(uint64_t) || memcmp(buf.data(), ckpt_magic, 8))
+	 throw "Not a checkpoint";
+	const uint8_t* const end = buf.data() + buf.size() - sizeof(uint64_t);
+	uint64_t checksum;
+	memcpy(&checksum, end, sizeof(checksum));
+	if(checksum != fnv1a(buf.data(), end - buf.data()))
+	 throw "Checkpoint is corrupt";
+
+	const uint8_t* ptr = buf.data() + 8;
+	get(ptr, end, width);
+	get(ptr, end, height);
+	get(ptr, end, number);
+	get(ptr, end, done);
+	get(ptr, end, seed);
+	for(uint64_t& s : rng_state)
+	 get(ptr, end, s);
+	get(ptr, end, log_type);
+	get(ptr, end, log_offset);
+	get(ptr, end, log_state);
+	get(ptr, end, every_grains);
+	get(ptr, end, every_seconds);
+	if((std::size_t)(end - ptr) != (std::size_t)width * height * sizeof(int32_t))
+	 throw "Checkpoint has a wrong grid size";
+	grid.resize((std::size_t)width * height);
+	memcpy(grid.data(), ptr, end - ptr);
+}
+
+}}
@@ -0,0 +1,57 @@
+/*************************************************************************/
+/* sca toolsuite - a toolsuite to simulate cellular automata.            */
+/* Copyright (C) 2011-2014                                               */
+/* Johannes Lorenz                                                       */
+/* https://github.com/JohannesLorenz/sca-toolsuite                       */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#ifndef THROW_CHECKPOINT_H
+#define THROW_CHECKPOINT_H
+
+#include <cstdint>
+#include <vector>
+
+namespace sca { namespace io {
+
+/**
+	@brief State of an algo/random_throw run, to resume it later.
+
+	Stored in native byte order, followed by an FNV-1a checksum.
+*/
+struct throw_checkpoint
+{
+	uint32_t width = 0, height = 0; //!< internal dimension
+	uint64_t number = 0; //!< total number of drops
+	uint64_t done = 0; //!< index of the next drop
+	uint64_t seed = 0;
+	uint64_t rng_state[4] = {};
+	char log_type = 0;
+	//! size of the log at the checkpoint, or -1 if it is not seekable
+	int64_t log_offset = -1;
+	int64_t log_state = 0; //!< state of the log writer, if any
+	uint64_t every_grains = 0, every_seconds = 0;
+	std::vector<int32_t> grid; //!< internal grid
+
+	//! writes to a temporary file which then replaces @a filename
+	//! @return false on IO errors
+	bool write(const char* filename) const;
+	//! @throws const char* if the file is missing or invalid
+	void read(const char* filename);
+};
+
+}}
+
+#endif // THROW_CHECKPOINT_H
@@ -0,0 +1,152 @@
+/*************************************************************************/
+/* sca toolsuite - a toolsuite to simulate cellular automata.            */
+/* Copyright (C) 2011-2014                                               */
+/* Johannes Lorenz                                                       */
+/* https://github.com/JohannesLorenz/sca-toolsuite                       */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#ifndef LEAST_ACTION_FIX_H
+#define LEAST_ACTION_FIX_H
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+#include "stack_algorithm.h"
+
+namespace sandpile
+{
+
+namespace internal
+{
+
+//! fix() logger that adds up how often each cell fires
+class fix_log_odometer
+{
+	const int* base = nullptr;
+	std::vector<uint64_t>& odometer;
+public:
+	fix_log_odometer(std::vector<uint64_t>& odometer) :
+		odometer(odometer) {}
+	void write_header(uint64_t grid) { base = (const int*)grid; }
+	void write_separator() const {}
+	void write_elem_to_file(const int* cell, const uint32_t* fire_times) {
+		odometer[cell - base] += *fire_times;
+	}
+};
+
+}
+
+/**
+	Computes the odometer of @a grid, i.e. how often each cell fires until
+	the grid is stable. Border cells never fire, their odometer is 0.
+
+	This is the least action principle applied to the binary digits of
+	the cells: if s' is s with each cell halved (rounded down), the
+	odometer u of s is at least 2u', where u' is the odometer of s'.
+	Firing 2u' from s leaves 2t' + (s mod 2), where t' is the result of
+	s', so only this configuration, with at most 7 grains per cell, must
+	be relaxed by fix(). Starting with the highest bit, one such level
+	is done per bit of the largest cell.
+	All interior cells must be >= 0.
+*/
+inline std::vector<uint64_t> least_action_odometer(
+	const std::vector<int>& grid, const dimension& dim)
+{
+	std::vector<uint64_t> odometer(grid.size(), 0);
+	std::vector<int> level(grid.size(), 0);
+	int max_cell = 0;
+	for(unsigned i = 0; i < grid.size(); ++i)
+	{
+		if(is_border(dim, i))
+		 level[i] = INT_MIN;
+		else
+		 max_cell = std::max(max_cell, grid[i]);
+	}
+
+	int bit = 0;
+	while(bit < 30 && (max_cell >> (bit + 1)))
+	 ++bit;
+
+	array_stack container(dim.area_without_border());
+	internal::fix_log_odometer logger(odometer);
+	logger.write_header((uint64_t)level.data());
+	const int INVERT_BIT = INT_MIN;
+	for(; bit >= 0; --bit)
+	{
+		for(unsigned i = 0; i < grid.size(); ++i)
+		if(level[i] < 0)
+		 level[i] = INT_MIN; // border grains are not needed here
+		else
+		{
+			level[i] = (level[i] << 1) | ((grid[i] >> bit) & 1);
+			odometer[i] <<= 1;
+			if(level[i] > 3)
+			{
+				container.push(level.data() + i);
+				level[i] |= INVERT_BIT;
+			}
+		}
+		if(!container.empty())
+		 do_fix(dim, container, logger);
+	}
+	return odometer;
+}
+
+/**
+	Alternative to fix() (without hint) for configurations with few, but
+	very large piles, like 10^8 grains on a single cell. The odometer is
+	computed by least_action_odometer(), and the result is derived from it,
+	i.e. each cell gets one grain for each time a neighbour fires and loses
+	four each time it fires itself. This includes the grains on the border,
+	so the result equals the one of fix().
+*/
+inline void least_action_fix(std::vector<int>& grid, const dimension& dim)
+{
+	const std::vector<uint64_t> odometer =
+		least_action_odometer(grid, dim);
+	const unsigned w = dim.width();
+	for(unsigned i = 0; i < grid.size(); ++i)
+	{
+		const unsigned x = i % w, y = i / w;
+		int64_t in = 0; // grains from the neighbours
+		if(x > 0) in += odometer[i - 1];
+		if(x + 1 < w) in += odometer[i + 1];
+		if(y > 0) in += odometer[i - w];
+		if(y + 1 < dim.height()) in += odometer[i + w];
+		grid[i] = (int)(grid[i] + in - 4 * (int64_t)odometer[i]);
+	}
+}
+
+//! returns whether least_action_fix() is probably faster than fix()
+//!  for @a grid, i.e. if a few cells hold most of the grains
+inline bool least_action_is_faster(const std::vector<int>& grid,
+	const dimension& dim)
+{
+	int64_t grains = 0, largest = 0;
+	for(unsigned i = 0; i < grid.size(); ++i)
+	 if(!is_border(dim, i) && grid[i] > 0)
+	{
+		grains += grid[i];
+		largest = std::max<int64_t>(largest, grid[i]);
+	}
+	return largest >= 4096 && largest * 4 >= grains;
+}
+
+}
+
+#endif // LEAST_ACTION_FIX_H
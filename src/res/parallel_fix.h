@@ -0,0 +1,192 @@
+/*************************************************************************/
+/* sca toolsuite - a toolsuite to simulate cellular automata.            */
+/* Copyright (C) 2011-2014                                               */
+/* Johannes Lorenz                                                       */
+/* https://github.com/JohannesLorenz/sca-toolsuite                       */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#ifndef PARALLEL_FIX_H
+#define PARALLEL_FIX_H
+
+#include <algorithm>
+#include <climits>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "stack_algorithm.h"
+
+namespace sandpile
+{
+
+namespace internal
+{
+
+/**
+	@brief A horizontal band of rows, relaxed by one thread.
+
+	The band is copied into its own array, with one halo row above and
+	below. Halo cells start at INT_MIN, so like the grid border, they
+	collect grains, but never fire. This way, do_fix() can run unchanged.
+*/
+class fix_band
+{
+	const unsigned width; //!< internal width, border included
+	const unsigned first_row; //!< first internal grid row owned
+	const unsigned rows; //!< number of grid rows owned
+	std::vector<int> cells; //!< rows + 2 halo rows
+	array_stack container;
+	fix_log_s logger;
+
+	int* row(unsigned r) { return cells.data() + r * width; }
+	void reset_halo(unsigned r) { std::fill_n(row(r), width, INT_MIN); }
+public:
+	fix_band(const std::vector<int>& grid, const dimension& dim,
+		unsigned first_row, unsigned rows) :
+		width(dim.width()),
+		first_row(first_row),
+		rows(rows),
+		cells((rows + 2) * width),
+		container(rows * (width - 2)),
+		logger(nullptr)
+	{
+		std::copy_n(grid.data() + first_row * width, rows * width,
+			row(1));
+		reset_halo(0);
+		reset_halo(rows + 1);
+	}
+
+	//! pushes every non-border cell, like fix() without hint
+	void push_all()
+	{
+		const int INVERT_BIT = (1 << 31);
+		for(unsigned r = 1; r <= rows; ++r)
+		for(int* ptr = row(r) + 1; ptr != row(r) + width - 1; ++ptr)
+		{
+			container.push(ptr);
+			*ptr |= INVERT_BIT;
+		}
+	}
+
+	void relax()
+	{
+		if(!container.empty())
+		 do_fix(dimension(width, rows + 2), container, logger);
+	}
+
+	int* top_halo() { return row(0); }
+	int* bottom_halo() { return row(rows + 1); }
+	int* top_row() { return row(1); }
+	int* bottom_row() { return row(rows); }
+
+	//! moves grains from @a halo to @a dest, which must be in a
+	//!  band (or the grid border), and resets @a halo
+	//! @return true iff any grain was moved
+	bool drain(int* halo, int* dest, bool push)
+	{
+		const int INVERT_BIT = (1 << 31);
+		bool moved = false;
+		for(unsigned x = 0; x < width; ++x)
+		if(halo[x] != INT_MIN)
+		{
+			moved = true;
+			dest[x] += halo[x] - INT_MIN;
+			if(push && dest[x] > 3)
+			{
+				dest[x] |= INVERT_BIT;
+				container.push(dest + x);
+			}
+			halo[x] = INT_MIN;
+		}
+		return moved;
+	}
+
+	void copy_back(std::vector<int>& grid) {
+		std::copy_n(row(1), rows * width,
+			grid.data() + first_row * width);
+	}
+};
+
+}
+
+/**
+	Multi-threaded variant of fix() without hint.
+	The grid is split into horizontal bands, which are relaxed in
+	parallel. Grains crossing a band border are collected in halo rows
+	and moved after all threads are done. This is repeated until no grains
+	cross any border.
+	By the abelian property, the result (including the grains on the
+	border) equals the one of fix().
+	@param threads number of threads, at most the grid height is used
+*/
+inline void parallel_fix(std::vector<int>& grid, const dimension& dim,
+	unsigned threads)
+{
+	const unsigned height = dim.height() - 2;
+	if(threads > height)
+	 threads = height;
+	if(threads < 2)
+	{
+		array_stack container(dim.area_without_border());
+		fix_log_s logger(nullptr);
+		fix(grid, dim, container, logger);
+		return;
+	}
+
+	// the containers can not be copied, so the bands are never moved
+	std::vector<std::unique_ptr<internal::fix_band>> bands(threads);
+	for(unsigned i = 0, first_row = 1; i < threads; ++i)
+	{
+		const unsigned rows = height / threads + (i < height % threads);
+		bands[i].reset(new internal::fix_band(grid, dim, first_row, rows));
+		bands[i]->push_all();
+		first_row += rows;
+	}
+
+	int* const top_border = grid.data();
+	int* const bottom_border = grid.data() + (dim.height() - 1) * dim.width();
+
+	bool exchanged;
+	do
+	{
+		std::vector<std::thread> workers;
+		for(unsigned i = 1; i < threads; ++i)
+		 workers.emplace_back(&internal::fix_band::relax, bands[i].get());
+		bands[0]->relax();
+		for(std::thread& t : workers)
+		 t.join();
+
+		// border grains are kept to make the result equal to fix()
+		exchanged = false;
+		bands[0]->drain(bands[0]->top_halo(), top_border, false);
+		bands[threads - 1]->drain(bands[threads - 1]->bottom_halo(),
+			bottom_border, false);
+		for(unsigned i = 1; i < threads; ++i)
+		{
+			exchanged |= bands[i]->drain(bands[i-1]->bottom_halo(),
+				bands[i]->top_row(), true);
+			exchanged |= bands[i-1]->drain(bands[i]->top_halo(),
+				bands[i-1]->bottom_row(), true);
+		}
+	} while(exchanged);
+
+	for(const auto& b : bands)
+	 b->copy_back(grid);
+}
+
+}
+
+#endif // PARALLEL_FIX_H
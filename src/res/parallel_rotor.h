@@ -0,0 +1,304 @@
+/*************************************************************************/
+/* sca toolsuite - a toolsuite to simulate cellular automata.            */
+/* Copyright (C) 2011-2014                                               */
+/* Johannes Lorenz                                                       */
+/* https://github.com/JohannesLorenz/sca-toolsuite                       */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#ifndef PARALLEL_ROTOR_H
+#define PARALLEL_ROTOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "rotor_algorithm.h"
+
+namespace rotor
+{
+
+namespace internal
+{
+
+//! chips for one cell of a band's outer row, sent to the next band
+struct chip_message
+{
+	uint32_t x;
+	int32_t chips;
+};
+
+/**
+	@brief Lock-free ring of chip_message, for one sending and one
+	receiving thread.
+*/
+class mailbox
+{
+	static constexpr std::size_t size = 1 << 12; //!< power of 2
+	std::vector<chip_message> ring;
+	std::atomic<std::size_t> head; //!< next message to read
+	std::atomic<std::size_t> tail; //!< next message to write
+public:
+	mailbox() : ring(size), head(0), tail(0) {}
+
+	//! @return false if the ring is full
+	bool post(const chip_message& m)
+	{
+		const std::size_t t = tail.load(std::memory_order_relaxed);
+		if(t - head.load(std::memory_order_acquire) == size)
+		 return false;
+		ring[t & (size - 1)] = m;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	//! only the receiving thread may call this
+	bool empty() const {
+		return head.load(std::memory_order_relaxed)
+			== tail.load(std::memory_order_acquire);
+	}
+
+	//! @return false if there is no message
+	bool fetch(chip_message& m)
+	{
+		const std::size_t h = head.load(std::memory_order_relaxed);
+		if(h == tail.load(std::memory_order_acquire))
+		 return false;
+		m = ring[h & (size - 1)];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+};
+
+/**
+	@brief A horizontal band of rows, run by one thread.
+
+	Like sandpile::internal::fix_band, the band has a halo row above and
+	below, whose chips start at INT_MIN, so do_packed_rotor_fix() runs
+	unchanged. Chips in a halo row are sent to the neighbour band
+	through a mailbox while the threads run. The outer halos of the
+	first and last band are the grid border and keep their chips.
+*/
+class rotor_band
+{
+	const unsigned width; //!< internal width, border included
+	const unsigned first_row; //!< first internal grid row owned
+	const unsigned rows; //!< number of grid rows owned
+	std::vector<packed_cell> cells; //!< rows + 2 halo rows
+	sandpile::_array_stack<packed_cell*> container;
+	//! mailboxes, nullptr at the grid border
+	mailbox *out_top = nullptr, *out_bottom = nullptr,
+		*in_top = nullptr, *in_bottom = nullptr;
+
+	packed_cell* row(unsigned r) { return cells.data() + r * width; }
+
+	//! sends the chips of @a halo to @a out, counting each message
+	//! in @a work before it is sent
+	//! @return false if @a out was full
+	bool send(packed_cell* halo, mailbox* out,
+		std::atomic<int64_t>& work)
+	{
+		for(unsigned x = 1; x < width - 1; ++x)
+		if(halo[x].chips != INT_MIN)
+		{
+			++work;
+			if(!out->post({ x, halo[x].chips - INT_MIN }))
+			{
+				--work;
+				return false;
+			}
+			halo[x].chips = INT_MIN;
+		}
+		return true;
+	}
+
+	//! adds all chips from @a in to row @a dest and pushes the cells
+	void receive(mailbox* in, packed_cell* dest,
+		std::atomic<int64_t>& work)
+	{
+		chip_message m;
+		while(in->fetch(m))
+		{
+			helpers::add_push_neighbour(dest + m.x, m.chips, container);
+			--work;
+		}
+	}
+
+	bool has_mail() const {
+		return (in_top && !in_top->empty())
+			|| (in_bottom && !in_bottom->empty());
+	}
+public:
+	rotor_band(const std::vector<packed_cell>& grid, const dimension& dim,
+		unsigned first_row, unsigned rows) :
+		width(dim.width()),
+		first_row(first_row),
+		rows(rows),
+		cells((rows + 2) * width),
+		container(rows * (width - 2))
+	{
+		std::copy_n(grid.data() + first_row * width, rows * width,
+			row(1));
+		for(unsigned r : { 0u, rows + 1 })
+		 for(unsigned x = 0; x < width; ++x)
+		  row(r)[x] = { INT_MIN, 0 };
+
+		for(unsigned r = 1; r <= rows; ++r)
+		for(packed_cell* c = row(r); c != row(r) + width; ++c)
+		if(c->chips > 0)
+		{
+			c->chips |= helpers::INVERT_BIT;
+			container.push(c);
+		}
+	}
+
+	//! connects this band to the one below
+	void connect(rotor_band& below, mailbox& down, mailbox& up)
+	{
+		out_bottom = below.in_top = &down;
+		below.out_top = in_bottom = &up;
+	}
+
+	/**
+		Runs until all bands have no chips left.
+		@param work number of running bands plus messages in flight,
+			initially the number of bands
+	*/
+	void run(std::atomic<int64_t>& work)
+	{
+		const dimension dim(width, rows + 2);
+		bool active = true;
+		while(true)
+		{
+			if(!active)
+			{
+				// become active before taking the messages,
+				// so work can not be 0 in between
+				if(has_mail())
+				{
+					++work;
+					active = true;
+				}
+				else if(!work)
+				 return;
+				else
+				{
+					std::this_thread::yield();
+					continue;
+				}
+			}
+
+			if(in_top)
+			 receive(in_top, row(1), work);
+			if(in_bottom)
+			 receive(in_bottom, row(rows), work);
+			if(!container.empty())
+			 helpers::do_packed_rotor_fix(dim, container);
+			const bool sent = (!out_top || send(row(0), out_top, work))
+				& (!out_bottom || send(row(rows + 1), out_bottom, work));
+			if(sent && !has_mail())
+			{
+				active = false;
+				--work;
+			}
+		}
+	}
+
+	//! copies the band back, and the chips of the outer halos into
+	//! the grid border
+	void copy_back(std::vector<packed_cell>& grid)
+	{
+		std::copy_n(row(1), rows * width,
+			grid.data() + first_row * width);
+		if(!out_top)
+		 for(unsigned x = 0; x < width; ++x)
+		  grid[(first_row - 1) * width + x].chips
+			+= row(0)[x].chips - INT_MIN;
+		if(!out_bottom)
+		 for(unsigned x = 0; x < width; ++x)
+		  grid[(first_row + rows) * width + x].chips
+			+= row(rows + 1)[x].chips - INT_MIN;
+	}
+};
+
+}
+
+/**
+	Multi-threaded variant of packed_rotor_fix() without hint.
+	The grid is split into horizontal bands, one per thread. Chips
+	crossing a band border are passed through lock-free mailboxes while
+	the threads run. It ends when no band has chips and no mailbox
+	has messages.
+	By the abelian property of rotor walks, the result (including the
+	chips on the border) equals the one of packed_rotor_fix().
+	@param threads number of threads, at most the grid height is used
+*/
+inline void parallel_rotor_fix(std::vector<packed_cell>& cells,
+	const dimension& dim, unsigned threads)
+{
+	const unsigned height = dim.height() - 2;
+	if(threads > height)
+	 threads = height;
+	if(threads < 2)
+	{
+		sandpile::_array_stack<packed_cell*> container(
+			dim.area_without_border());
+		sandpile::_fix_log_s<int> logger(nullptr);
+		packed_rotor_fix(cells, dim, container, logger);
+		return;
+	}
+
+	// the containers can not be copied, so the bands are never moved
+	std::vector<std::unique_ptr<internal::rotor_band>> bands(threads);
+	for(unsigned i = 0, first_row = 1; i < threads; ++i)
+	{
+		const unsigned rows = height / threads + (i < height % threads);
+		bands[i].reset(new internal::rotor_band(cells, dim, first_row,
+			rows));
+		first_row += rows;
+	}
+	std::vector<internal::mailbox> mailboxes(2 * (threads - 1));
+	for(unsigned i = 1; i < threads; ++i)
+	 bands[i-1]->connect(*bands[i], mailboxes[2*i - 2],
+		mailboxes[2*i - 1]);
+
+	std::atomic<int64_t> work(threads);
+	std::vector<std::thread> workers;
+	for(unsigned i = 1; i < threads; ++i)
+	 workers.emplace_back(&internal::rotor_band::run, bands[i].get(),
+		std::ref(work));
+	bands[0]->run(work);
+	for(std::thread& t : workers)
+	 t.join();
+
+	for(const auto& b : bands)
+	 b->copy_back(cells);
+}
+
+//! version for separate grids, which packs and unpacks them
+inline void parallel_rotor_fix(grid_t& grid, grid_t& chips,
+	unsigned threads)
+{
+	std::vector<packed_cell> cells = pack(grid, chips);
+	parallel_rotor_fix(cells, grid.internal_dim(), threads);
+	unpack(cells, grid, chips);
+}
+
+}
+
+#endif // PARALLEL_ROTOR_H
@@ -0,0 +1,119 @@
+/*************************************************************************/
+/* sca toolsuite - a toolsuite to simulate cellular automata.            */
+/* Copyright (C) 2011-2014                                               */
+/* Johannes Lorenz                                                       */
+/* https://github.com/JohannesLorenz/sca-toolsuite                       */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "perf_counters.h"
+
+namespace sandpile {
+
+static int open_counter(uint32_t type, uint64_t config)
+{
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	// this thread, any cpu, no group: missing events do not hide others
+	return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static constexpr uint64_t cache_miss(uint64_t cache)
+{
+	return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+		| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+perf_counters::perf_counters()
+{
+	fds[cycles] = open_counter(PERF_TYPE_HARDWARE,
+		PERF_COUNT_HW_CPU_CYCLES);
+	fds[instructions] = open_counter(PERF_TYPE_HARDWARE,
+		PERF_COUNT_HW_INSTRUCTIONS);
+	fds[l1d_misses] = open_counter(PERF_TYPE_HW_CACHE,
+		cache_miss(PERF_COUNT_HW_CACHE_L1D));
+	fds[llc_misses] = open_counter(PERF_TYPE_HW_CACHE,
+		cache_miss(PERF_COUNT_HW_CACHE_LL));
+	fds[branch_misses] = open_counter(PERF_TYPE_HARDWARE,
+		PERF_COUNT_HW_BRANCH_MISSES);
+}
+
+perf_counters::~perf_counters()
+{
+	for(const int& fd : fds)
+	 if(fd >= 0)
+	  close(fd);
+}
+
+void perf_counters::start()
+{
+	for(const int& fd : fds)
+	 if(fd >= 0)
+	{
+		ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+	}
+	start_time = clock::now();
+}
+
+void perf_counters::stop()
+{
+	const clock::time_point stop_time = clock::now();
+	for(int e = 0; e < num_events; ++e)
+	 if(fds[e] >= 0)
+	{
+		ioctl(fds[e], PERF_EVENT_IOC_DISABLE, 0);
+		if(::read(fds[e], values + e, sizeof(uint64_t))
+			!= sizeof(uint64_t))
+		 values[e] = 0;
+	}
+	seconds = std::chrono::duration<double>(stop_time - start_time).count();
+}
+
+void perf_counters::print(FILE* fp, uint64_t grains, uint64_t topples,
+	uint64_t pushes) const
+{
+	static const char* const names[num_events] = {
+		"cycles", "instructions", "L1d misses", "LLC misses",
+		"branch misses"
+	};
+	// everything per 10.000 grains
+	const double norm = grains ? 10000.0 / grains : 0.0;
+
+	fprintf(fp, "grains: %llu\n", (unsigned long long)grains);
+	fputs("per 10.000 grains:\n", fp);
+	fprintf(fp, "seconds: %.6f\n", seconds * norm);
+	fprintf(fp, "topples: %.1f\n", topples * norm);
+	fprintf(fp, "pushes: %.1f\n", pushes * norm);
+	for(int e = 0; e < num_events; ++e)
+	 if(fds[e] >= 0)
+	  fprintf(fp, "%s: %.1f\n", names[e], values[e] * norm);
+	 else
+	  fprintf(fp, "%s: n/a\n", names[e]);
+}
+
+}
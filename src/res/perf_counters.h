@@ -0,0 +1,123 @@
+/*************************************************************************/
+/* sca toolsuite - a toolsuite to simulate cellular automata.            */
+/* Copyright (C) 2011-2014                                               */
+/* Johannes Lorenz                                                       */
+/* https://github.com/JohannesLorenz/sca-toolsuite                       */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <cstdint>
+#include <cstdio>
+#include <chrono>
+
+#include "stack_algorithm.h"
+
+namespace sandpile
+{
+
+/**
+	@brief Reads hardware counters of the calling thread with
+	perf_event_open, e.g. around l_hint() or fix().
+
+	Counters which the machine does not provide (often the cache
+	counters in virtual machines) are reported as "n/a".
+	Only create this for profiling; nothing else pays for it.
+*/
+class perf_counters
+{
+public:
+	enum event
+	{
+		cycles,
+		instructions,
+		l1d_misses,
+		llc_misses,
+		branch_misses,
+		num_events
+	};
+private:
+	using clock = std::chrono::steady_clock;
+	int fds[num_events];
+	uint64_t values[num_events] = {};
+	clock::time_point start_time;
+	double seconds = 0.0;
+public:
+	perf_counters();
+	~perf_counters();
+	perf_counters(const perf_counters& ) = delete;
+	perf_counters& operator=(const perf_counters& ) = delete;
+
+	//! resets and starts all counters
+	void start();
+	//! stops all counters and reads them
+	void stop();
+
+	//! @return false if @a e is not available
+	bool available(event e) const { return fds[e] >= 0; }
+	uint64_t value(event e) const { return values[e]; }
+
+	/**
+		Prints all counters, the time and the given software counters,
+		each normalized to 10.000 grains, like in BENCHMARKS.txt.
+		@param topples number of times any cell fired
+		@param pushes number of pushes to the avalanche container
+	*/
+	void print(FILE* fp, uint64_t grains, uint64_t topples,
+		uint64_t pushes) const;
+};
+
+/**
+	@brief Avalanche container counting pushes, pops and avalanches.
+
+	For l_hint(), every pop is one topple and every avalanche is one
+	grain. Only use it for profiling, the plain containers do not
+	count anything.
+*/
+template<class Container>
+class counting : public Container
+{
+	uint64_t _pushes = 0, _pops = 0, _avalanches = 0;
+public:
+	using Container::Container;
+	using value_type = typename Container::value_type;
+	inline void push(const value_type& v) { ++_pushes; Container::push(v); }
+	inline value_type pop() { ++_pops; return Container::pop(); }
+	inline void write_separator() {
+		++_avalanches; Container::write_separator();
+	}
+	uint64_t pushes() const { return _pushes; }
+	uint64_t pops() const { return _pops; }
+	uint64_t avalanches() const { return _avalanches; }
+};
+
+//! logger for fix() which counts topples, i.e. adds up all fire counts
+template<class T>
+class fix_log_count : public log_nothing_base<T>
+{
+	uint64_t _topples = 0;
+public:
+	fix_log_count(FILE* ) {}
+	inline void write_elem_to_file(const T, const uint32_t* ntimes) {
+		_topples += *ntimes;
+	}
+	uint64_t topples() const { return _topples; }
+};
+
+}
+
+#endif // PERF_COUNTERS_H
@@ -22,6 +22,7 @@
 #define RANDOM_H
 
 #include <cstdlib>
+#include <cstdint>
 #include <sys/types.h>
 #include <unistd.h>
 #include <ctime>
@@ -49,6 +50,67 @@ inline unsigned int get_int(unsigned int max) {
 	return (unsigned int) (((float)max)*random()/(RAND_MAX+1.0));
 }
 
+/**
+	@brief Seedable xoshiro256** generator (Blackman, Vigna).
+
+	Unlike random(), the sequence only depends on the seed, not on the
+	libc, so results are reproducible on every machine.
+*/
+class xoshiro256ss
+{
+	uint64_t s[4];
+
+	static uint64_t rotl(const uint64_t x, int k) {
+		return (x << k) | (x >> (64 - k));
+	}
+public:
+	//! the state is filled using splitmix64, as proposed by the authors
+	explicit xoshiro256ss(uint64_t seed) { set_seed(seed); }
+
+	void set_seed(uint64_t seed)
+	{
+		for(uint64_t& word : s)
+		{
+			uint64_t z = (seed += 0x9e3779b97f4a7c15);
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+			word = z ^ (z >> 31);
+		}
+	}
+
+	uint64_t operator()()
+	{
+		const uint64_t result = rotl(s[1] * 5, 7) * 9;
+		const uint64_t t = s[1] << 17;
+		s[2] ^= s[0];
+		s[3] ^= s[1];
+		s[1] ^= s[2];
+		s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = rotl(s[3], 45);
+		return result;
+	}
+
+	//! Returns an unbiased value in [0, range-1], range must be > 0.
+	//! Uses Lemire's multiply-and-reject method, which almost never
+	//! needs a division.
+	uint32_t bounded(uint32_t range)
+	{
+		uint64_t m = (uint64_t)(uint32_t)((*this)() >> 32) * range;
+		if((uint32_t)m < range)
+		{
+			const uint32_t threshold = (uint32_t)(-range) % range;
+			while((uint32_t)m < threshold)
+			 m = (uint64_t)(uint32_t)((*this)() >> 32) * range;
+		}
+		return (uint32_t)(m >> 32);
+	}
+
+	//! access to the state, e.g. for saving it
+	const uint64_t* state() const { return s; }
+	uint64_t* state() { return s; }
+};
+
 }
 
 #endif // RANDOM_H
@@ -22,6 +22,7 @@
 #define ROTOR_ALGORITHM_H
 
 #include <stack_algorithm.h>
+#include "growing_grid.h"
 
 namespace rotor
 {
@@ -144,6 +145,164 @@ inline void rotor_fix(grid_t& grid, grid_t& chips,
 	helpers::do_rotor_fix(grid, chips, array, result_logger);
 }
 
+/**
+	@brief Rotor and chips of one cell, interleaved in one word.
+
+	do_rotor_fix() works on indices into two vectors, so each step
+	touches two cache lines. With packed cells, it is only one.
+	Like in the chips grid, border cells have chips = INT_MIN.
+*/
+struct packed_cell
+{
+	int32_t chips; //!< the sign bit means "on the stack"
+	int32_t rotor;
+};
+
+//! interleaves the rotors of @a grid with @a chips, including the border
+inline std::vector<packed_cell> pack(const grid_t& grid, const grid_t& chips)
+{
+	assert(grid.internal_dim() == chips.internal_dim());
+	std::vector<packed_cell> cells(grid.data().size());
+	for(std::size_t i = 0; i < cells.size(); ++i)
+	{
+		cells[i].chips = chips.data()[i];
+		cells[i].rotor = grid.data()[i];
+	}
+	return cells;
+}
+
+//! inverse of pack()
+inline void unpack(const std::vector<packed_cell>& cells,
+	grid_t& grid, grid_t& chips)
+{
+	for(std::size_t i = 0; i < cells.size(); ++i)
+	{
+		chips.data()[i] = cells[i].chips;
+		grid.data()[i] = cells[i].rotor;
+	}
+}
+
+namespace helpers
+{
+
+template<class AvalancheContainer>
+inline void add_push_neighbour(packed_cell* const cell, int32_t n,
+	AvalancheContainer& array)
+{
+	if((cell->chips += n) >= 0)
+	{
+		cell->chips |= INVERT_BIT;
+		array.push(cell);
+	}
+}
+
+//! like do_rotor_fix(), but on packed cells with a pointer stack
+template<class AvalancheContainer>
+inline void do_packed_rotor_fix(const dimension& dim,
+	AvalancheContainer& array)
+{
+	const int32_t GRAIN_BITS = ~INVERT_BIT;
+	const int32_t w = dim.width();
+	const int32_t PALETTE[7] = { -w, 1, w, -1, -w, 1, w };
+
+	do {
+		packed_cell* const cur = array.pop();
+		int32_t n = cur->chips & GRAIN_BITS;
+
+		if(const int32_t n4 = n >> 2)
+		{
+			add_push_neighbour(cur - w, n4, array);
+			add_push_neighbour(cur - 1, n4, array);
+			add_push_neighbour(cur + 1, n4, array);
+			add_push_neighbour(cur + w, n4, array);
+		}
+
+		n &= 3;
+		int32_t rotor = cur->rotor;
+		for(int32_t i = 0; i < n; ++i)
+		 add_push_neighbour(cur + PALETTE[++rotor], 1, array);
+		cur->rotor = (cur->rotor + n) & 3;
+		cur->chips = 0;
+	} while( ! array.empty() );
+}
+
+}
+
+/**
+	Like rotor_fix() with a hint, but on packed cells (see packed_cell)
+	and with a pointer stack. The final state is the same.
+	@param cells result of pack()
+	@param array container with value_type packed_cell*,
+		e.g. sandpile::_array_stack<packed_cell*>
+*/
+template<class AvalancheContainer, class ResultType>
+inline void packed_rotor_fix(std::vector<packed_cell>& cells,
+	const dimension& dim, int hint, AvalancheContainer& array,
+	ResultType& result_logger)
+{
+	if(cells[hint].chips > 0)
+	{
+		array.push(&cells[hint]);
+		helpers::do_packed_rotor_fix(dim, array);
+	}
+	result_logger.write_separator();
+	array.flush();
+}
+
+//! version without hint, runs the chips of all cells
+template<class AvalancheContainer, class ResultType>
+inline void packed_rotor_fix(std::vector<packed_cell>& cells,
+	const dimension& dim, AvalancheContainer& array,
+	ResultType& result_logger)
+{
+	for(unsigned i = 0; i < cells.size(); ++i)
+	 if(cells[i].chips > 0)
+	{
+		cells[i].chips |= helpers::INVERT_BIT;
+		array.push(&cells[i]);
+	}
+	if(!array.empty())
+	 helpers::do_packed_rotor_fix(dim, array);
+	result_logger.write_separator();
+	array.flush();
+}
+
+//! version for separate grids, which packs and unpacks them
+template<class AvalancheContainer, class ResultType>
+inline void packed_rotor_fix(grid_t& grid, grid_t& chips,
+	int hint, AvalancheContainer& array, ResultType& result_logger)
+{
+	std::vector<packed_cell> cells = pack(grid, chips);
+	packed_rotor_fix(cells, grid.internal_dim(), hint, array,
+		result_logger);
+	unpack(cells, grid, chips);
+}
+
+/**
+	Rotor-router aggregation: each of @a chips chips starts at @a x, @a y
+	and walks like in rotor_fix() until it reaches an unoccupied cell,
+	which it occupies. On a growing_grid, the aggregate can grow without
+	bounds, since there is no border to lose chips on.
+	@param grid cells are 0 if unoccupied, otherwise the rotor plus 1
+*/
+template<unsigned TileBits>
+inline void rotor_aggregate(sandpile::growing_grid<int, TileBits>& grid,
+	uint64_t chips, int x, int y)
+{
+	using cell_ref = typename sandpile::growing_grid<int, TileBits>::cell_ref;
+	for(; chips; --chips)
+	{
+		cell_ref cur = grid.at(x, y);
+		while(*cur)
+		{
+			const int rotor = *cur & 3; // (rotor + 1) & 3
+			*cur = rotor + 1;
+			cur = grid.step(cur, rotor);
+		}
+		*cur = 1;
+	}
+}
+
 template<class AvalancheContainer, class ResultType>
 inline void rotor_fix_naive(grid_t& grid, grid_t& chips,
 	AvalancheContainer&, ResultType& result_logger)
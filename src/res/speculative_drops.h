@@ -0,0 +1,378 @@
+/*************************************************************************/
+/* sca toolsuite - a toolsuite to simulate cellular automata.            */
+/* Copyright (C) 2011-2014                                               */
+/* Johannes Lorenz                                                       */
+/* https://github.com/JohannesLorenz/sca-toolsuite                       */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#ifndef SPECULATIVE_DROPS_H
+#define SPECULATIVE_DROPS_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "stack_algorithm.h"
+
+namespace sandpile
+{
+
+namespace internal
+{
+
+/**
+	@brief Avalanche container which records all fired cells.
+
+	Like _array_queue, but the cells of each wave are appended to
+	fired, as indices, instead of being logged.
+*/
+template<class T>
+class _array_queue_recorder : public _array_queue_base<T>
+{
+	typedef _array_queue_base<T> base;
+	T origin = nullptr;
+public:
+	using value_type = T;
+	std::vector<unsigned> fired;
+
+	inline _array_queue_recorder(unsigned human_grid_size) :
+		base(human_grid_size) {}
+
+	inline void write_header(uint64_t grid_offset) {
+		origin = (T)grid_offset;
+	}
+	inline void write_separator() const {}
+	inline void write_to_file()
+	{
+		for(const T* p = base::array + 1; p <= base::write_ptr; ++p)
+		 fired.push_back(*p - origin);
+	}
+};
+
+//! logging class for runs without any log
+template<class T>
+class log_none
+{
+public:
+	inline void write_header(uint64_t ) const {}
+	inline void write_separator() const {}
+	inline void write_array_to_file(T* const , const int ) const {}
+};
+
+}
+
+/**
+	@brief Throws grains in windows of drops, relaxing them speculatively
+	on multiple threads.
+
+	Each thread relaxes its drops on a private copy of the grid. The
+	footprint of an avalanche is the drop cell, the fired cells and
+	their neighbours; it contains all cells the avalanche has read.
+	The results are then committed in drop order. If a footprint meets
+	the footprint of an earlier drop of the window, the speculation read
+	outdated cells, so this drop is relaxed again, sequentially, on the
+	real grid. Thus, the resulting grid and the avalanches are exactly
+	those of the sequential algorithm.
+	The window shrinks when conflicts are frequent. If they stay
+	frequent, drops are relaxed sequentially for a while.
+*/
+template<class T>
+class speculative_dropper
+{
+	using recorder_t = internal::_array_queue_recorder<T*>;
+
+	//! result of one speculative drop
+	struct result_t
+	{
+		unsigned idx;
+		std::vector<unsigned> fired; //!< in the order of firing
+		std::vector<unsigned> cells; //!< footprint, without border
+		std::vector<T> values; //!< values of cells after relaxing
+	};
+
+	//! state of one thread
+	struct worker_t
+	{
+		std::vector<T> grid;
+		border_guard<T> guard;
+		recorder_t recorder;
+		std::vector<uint32_t> marks;
+		uint32_t mark = 0;
+		worker_t(const std::vector<T>& grid, const dimension& dim) :
+			grid(grid),
+			recorder(dim.area_without_border()),
+			marks(grid.size(), 0)
+		{}
+	};
+
+	const dimension dim;
+	const unsigned threads, window;
+	unsigned cur_window; //!< adapted to the conflict rate
+	std::vector<uint8_t> border; //!< 1 for border cells
+	std::vector<std::unique_ptr<worker_t>> workers;
+	std::vector<unsigned> drop_idxs;
+	std::vector<result_t> results;
+	std::vector<uint32_t> committed; //!< window id of the last commit
+	uint32_t window_id = 0;
+	const std::vector<T>* shared = nullptr;
+
+	// thread pool
+	std::vector<std::thread> pool;
+	std::mutex mutex;
+	std::condition_variable cv_start, cv_done;
+	unsigned generation = 0, pending = 0;
+	bool quit = false;
+
+	//! computes the footprint of @a res, using the marks of @a w
+	void footprint(worker_t& w, result_t& res)
+	{
+		res.cells.clear();
+		if(!++w.mark) // overflow
+		{
+			std::fill(w.marks.begin(), w.marks.end(), 0);
+			w.mark = 1;
+		}
+		const auto add = [&](unsigned c) {
+			if(w.marks[c] != w.mark && !border[c])
+			{
+				w.marks[c] = w.mark;
+				res.cells.push_back(c);
+			}
+		};
+		add(res.idx);
+		for(const unsigned& c : res.fired)
+		{
+			add(c);
+			add(c - 1);
+			add(c + 1);
+			add(c - dim.width());
+			add(c + dim.width());
+		}
+	}
+
+	//! relaxes drop @a res.idx on @a grid, recording into @a res
+	void relax(worker_t& w, std::vector<T>& grid, border_guard<T>& guard,
+		result_t& res)
+	{
+		w.recorder.fired.clear();
+		grid[res.idx]++;
+		l_hint(grid, dim, res.idx, w.recorder, guard);
+		res.fired.swap(w.recorder.fired);
+		footprint(w, res);
+	}
+
+	//! speculates all drops of the window which belong to thread @a t
+	void speculate(unsigned t)
+	{
+		worker_t& w = *workers[t];
+		for(unsigned k = t; k < drop_idxs.size(); k += threads)
+		{
+			result_t& res = results[k];
+			res.idx = drop_idxs[k];
+			relax(w, w.grid, w.guard, res);
+			res.values.clear();
+			for(const unsigned& c : res.cells)
+			{
+				res.values.push_back(w.grid[c]);
+				w.grid[c] = (*shared)[c]; // undo
+			}
+		}
+	}
+
+	void work(unsigned t)
+	{
+		unsigned seen = 0;
+		for(;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cv_start.wait(lock, [&]{
+					return generation != seen || quit; });
+				if(quit)
+				 return;
+				seen = generation;
+			}
+			speculate(t);
+			std::lock_guard<std::mutex> lock(mutex);
+			if(!--pending)
+			 cv_done.notify_one();
+		}
+	}
+
+	//! runs speculate() on all threads
+	void speculate_all()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			++generation;
+			pending = threads - 1;
+		}
+		cv_start.notify_all();
+		speculate(0);
+		std::unique_lock<std::mutex> lock(mutex);
+		cv_done.wait(lock, [&]{ return !pending; });
+	}
+
+	template<class Log>
+	void log_avalanche(std::vector<T>& grid,
+		const std::vector<unsigned>& fired, Log& log)
+	{
+		std::vector<T*> ptrs(fired.size());
+		for(std::size_t i = 0; i < ptrs.size(); ++i)
+		 ptrs[i] = grid.data() + fired[i];
+		log.write_header((uint64_t)grid.data());
+		log.write_array_to_file(ptrs.data(), ptrs.size());
+		log.write_separator();
+	}
+
+public:
+	/**
+		@param grid the grid, with border as by to_cell_type()
+		@param window number of drops per window, for all threads
+	*/
+	speculative_dropper(const std::vector<T>& grid, const dimension& dim,
+		unsigned threads, unsigned window) :
+		dim(dim),
+		threads(threads),
+		window(window),
+		cur_window(window),
+		border(grid.size()),
+		committed(grid.size(), 0)
+	{
+		for(std::size_t i = 0; i < grid.size(); ++i)
+		 border[i] = is_border(dim, i);
+		for(unsigned t = 0; t < threads; ++t)
+		 workers.emplace_back(new worker_t(grid, dim));
+		for(unsigned t = 1; t < threads; ++t)
+		 pool.emplace_back(&speculative_dropper::work, this, t);
+	}
+
+	~speculative_dropper()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			quit = true;
+		}
+		cv_start.notify_all();
+		for(std::thread& th : pool)
+		 th.join();
+	}
+
+	/**
+		Throws all grains of @a drops onto @a grid, which must equal
+		the grid given to the constructor.
+		@param log class like log_base or log_varint, which gets the
+			avalanches in drop order
+	*/
+	template<class Drops, class Log>
+	void run(std::vector<T>& grid, Drops& drops, Log& log)
+	{
+		border_guard<T> guard;
+		worker_t& w0 = *workers[0];
+		shared = &grid;
+		unsigned idx;
+		//! if > 0, the number of windows to run sequentially
+		unsigned sequential = 0;
+		for(;;)
+		{
+			if(sequential)
+			{
+				// relax on the real grid only, without footprints
+				std::size_t n = 0;
+				for(; n < window && drops.next(idx); ++n)
+				{
+					w0.recorder.fired.clear();
+					grid[idx]++;
+					l_hint(grid, dim, idx, w0.recorder, guard);
+					log_avalanche(grid, w0.recorder.fired, log);
+				}
+				if(!n)
+				 break;
+				if(!--sequential)
+				for(std::unique_ptr<worker_t>& wp : workers)
+				{
+					wp->grid = grid;
+					border_guard<T>::reset(wp->grid, dim);
+				}
+				continue;
+			}
+
+			drop_idxs.clear();
+			while(drop_idxs.size() < cur_window && drops.next(idx))
+			 drop_idxs.push_back(idx);
+			if(drop_idxs.empty())
+			 break;
+			if(results.size() < drop_idxs.size())
+			 results.resize(drop_idxs.size());
+
+			speculate_all();
+			std::size_t conflicts = 0;
+
+			// commit in order
+			if(!++window_id)
+			{
+				std::fill(committed.begin(), committed.end(), 0);
+				window_id = 1;
+			}
+			for(std::size_t k = 0; k < drop_idxs.size(); ++k)
+			{
+				result_t& res = results[k];
+				bool valid = true;
+				for(std::size_t i = 0; valid && i < res.cells.size(); ++i)
+				 valid = committed[res.cells[i]] != window_id;
+				if(valid)
+				{
+					for(std::size_t i = 0; i < res.cells.size(); ++i)
+					 grid[res.cells[i]] = res.values[i];
+				}
+				else // conflict: relax again, on the real grid
+				{
+					res.idx = drop_idxs[k];
+					relax(w0, grid, guard, res);
+					++conflicts;
+				}
+				for(const unsigned& c : res.cells)
+				 committed[c] = window_id;
+				log_avalanche(grid, res.fired, log);
+			}
+
+			// large avalanches overlap often, so use smaller windows,
+			// or even no speculation for some time
+			if(conflicts * 4 > drop_idxs.size())
+			{
+				if(cur_window == threads)
+				 sequential = 16;
+				cur_window = std::max(threads, cur_window / 2);
+			}
+			else if(conflicts * 16 < drop_idxs.size())
+			 cur_window = std::min(window, cur_window * 2);
+
+			// bring the private grids up to date
+			if(!sequential)
+			for(std::unique_ptr<worker_t>& wp : workers)
+			for(std::size_t k = 0; k < drop_idxs.size(); ++k)
+			for(const unsigned& c : results[k].cells)
+			 wp->grid[c] = grid[c];
+		}
+	}
+};
+
+}
+
+#endif // SPECULATIVE_DROPS_H
@@ -21,11 +21,14 @@
 #ifndef STACK_ALGORITHM_H
 #define STACK_ALGORITHM_H
 
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <limits>
 #include <vector>
 #include <type_traits>
 #include "grid.h"
+#include "io/async_writer.h"
 
 namespace sandpile
 {
@@ -33,7 +36,24 @@ namespace sandpile
 /*
  * io logging classes
  */
-template<class T>
+
+//! writer for log_base, writing directly into the file
+class file_writer
+{
+	FILE* const fp;
+public:
+	file_writer(FILE* fp) : fp(fp) {}
+	inline void write(const void* ptr, std::size_t size, std::size_t n) {
+		fwrite(ptr, size, n, fp);
+	}
+};
+
+/**
+	@brief Logs avalanches in binary format.
+	@tparam Writer file_writer or sca::io::async_writer,
+		the output is the same
+*/
+template<class T, class Writer = file_writer>
 class log_base
 {
 	//! difference of two grid indices for non pointers
@@ -56,27 +76,33 @@ class log_base
 	};
 
 	const div_size_t<T> div_size;
-	FILE* fp;
+	mutable Writer writer;
+	mutable bool header_written = false;
 public:
-	log_base(FILE* fp) : div_size(), fp(fp) {}
+	log_base(FILE* fp) : div_size(), writer(fp) {}
 	inline void write_separator() const {
-		const uint64_t minus1 = -1; fwrite(&minus1, sizeof(T), 1, fp);
+		const uint64_t minus1 = -1; writer.write(&minus1, sizeof(T), 1);
 	}
+	//! only the first call writes the header, since the readers
+	//! expect it only once
 	inline void write_header(uint64_t grid_offset) const
 	{
+		if(header_written)
+		 return;
+		header_written = true;
 		constexpr static const char sizeof_t = sizeof(T);
 		constexpr static const char hdr[14] = {}; // initialized to 0
-		fwrite(&hdr, sizeof(hdr), 1, fp);
-		fwrite(&sizeof_t, 1, 1, fp); // size of each index
-		fwrite(&div_size.size(), 1, 1, fp); // diff between two index numbers
-		fwrite(&grid_offset, sizeof(uint64_t), 1, fp);
+		writer.write(&hdr, sizeof(hdr), 1);
+		writer.write(&sizeof_t, 1, 1); // size of each index
+		writer.write(&div_size.size(), 1, 1); // diff between two index numbers
+		writer.write(&grid_offset, sizeof(uint64_t), 1);
 	}
 	inline void write_elem_to_file(const T elem, const uint32_t* const ntimes) {
 		for(uint32_t i = 0; i < *ntimes; i++)
-		 fwrite(&elem, sizeof(T), 1, fp);
+		 writer.write(&elem, sizeof(T), 1);
 	}
 	inline void write_array_to_file(T* const ptr, const int num) const {
-		fwrite(ptr, sizeof(T), num, fp);
+		writer.write(ptr, sizeof(T), num);
 	}
 };
 
@@ -122,6 +148,50 @@ public:
 
 typedef _array_stack<int*> array_stack;
 
+namespace internal
+{
+	//! offset of a cell, as stored in the compact containers.
+	//! This is not an int32_t, which would alias int cells, and the
+	//! compiler would reload the container after each cell update.
+	enum class cell_offset : int32_t {};
+}
+
+/**
+	@brief Like _array_stack, but stores 32 bit offsets instead of T.
+
+	For pointers on 64 bit machines, this halves the memory of the stack,
+	which is as large as the grid's area. The offsets are relative to the
+	first element pushed onto the empty stack, so the grid must have
+	less than 2^31 cells.
+	@invariant stack_ptr points to top element
+*/
+template<class T = int*>
+class _array_stack_compact : public log_nothing_base<T>
+{
+	using offset_t = internal::cell_offset;
+	offset_t* const array; //! first element will never be read: "sentinel"
+	offset_t* stack_ptr;
+	T base;
+public:
+	using value_type = T;
+	inline _array_stack_compact(unsigned human_grid_size, FILE* = nullptr) :
+		array(new offset_t[human_grid_size+1]), stack_ptr(array), base() {}
+	inline ~_array_stack_compact() { delete[] array; }
+	inline T pop() { return base + (int32_t)*(stack_ptr--); }
+	inline void push(const T& i) {
+		if(empty())
+		 base = i;
+		*(++stack_ptr) = (offset_t)(i - base);
+	}
+	inline bool empty() const { return stack_ptr == array; }
+	inline void flush() const {}
+
+	// logging:
+	inline void write_to_file() const {}
+};
+
+typedef _array_stack_compact<int*> array_stack_compact;
+
 /**
 	@brief  Class for stack algorithm using a queue for the avalanches
 
@@ -158,23 +228,27 @@ public:
 	If this is not wanted, array_stack is faster.
 	@invariant write_ptr always points to the element last written
 */
-template<class T>
-class _array_queue : public _array_queue_base<T>, public log_base<T>
+template<class T, class Writer = file_writer>
+class _array_queue : public _array_queue_base<T>, public log_base<T, Writer>
 {
 	typedef _array_queue_base<T> base;
 public:
 	inline _array_queue(unsigned human_grid_size, FILE* fp) :
 		base(human_grid_size),
-		log_base<T>(fp) {}
+		log_base<T, Writer>(fp) {}
 
 	// logging:
 	inline void write_to_file() const {
-		log_base<T>::write_array_to_file(
+		log_base<T, Writer>::write_array_to_file(
 			base::array+1, base::write_ptr - base::array);
 	}
 };
 
 typedef _array_queue<int*> array_queue;
+//! writes from a separate thread, use this if IO is the bottleneck
+template<class T>
+using _array_queue_async = _array_queue<T, sca::io::async_writer>;
+typedef _array_queue_async<int*> array_queue_async;
 
 template<class T>
 class _array_queue_no_file : public _array_queue_base<T>, public log_nothing_base<T>
@@ -190,6 +264,46 @@ public:
 
 typedef _array_queue_no_file<int*> array_queue_no_file;
 
+/**
+	@brief Like _array_queue_no_file, but stores 32 bit offsets instead of T.
+
+	The offsets are relative to the first element pushed after a flush(),
+	so the grid must have less than 2^31 cells.
+	@invariant write_ptr always points to the element last written
+*/
+template<class T = int*>
+class _array_queue_compact : public log_nothing_base<T>
+{
+	using offset_t = internal::cell_offset;
+	offset_t* const array; //! first element will never be read
+	offset_t* read_ptr;
+	offset_t* write_ptr;
+	T base;
+public:
+	using value_type = T;
+	inline _array_queue_compact(unsigned human_grid_size, FILE* = nullptr) :
+		array(new offset_t[human_grid_size+1]),
+		read_ptr(array), write_ptr(array), base() {}
+	inline ~_array_queue_compact() { delete[] array; }
+	inline T pop() { return base + (int32_t)*(++read_ptr); }
+	inline void push(const T& i) {
+		if(write_ptr == array)
+		 base = i;
+		*(++write_ptr) = (offset_t)(i - base);
+	}
+	inline bool empty() const { return read_ptr == write_ptr; }
+	inline void flush() { read_ptr = write_ptr = array; }
+	inline unsigned int size() { return (unsigned int)(write_ptr-array); }
+	inline T operator[](unsigned i) const {
+		return base + (int32_t)array[i + 1];
+	}
+
+	// logging:
+	inline void write_to_file() const {}
+};
+
+typedef _array_queue_compact<int*> array_queue_compact;
+
 /*
  * algorithms
  */
@@ -223,15 +337,28 @@ void rec(const signed& grid_width, T const ptr)
 	}
 }*/
 
+//! neighbour access for row-major grids, see avalanche_1d_noflush()
+template<class T>
+class row_major_neighbours
+{
+	const signed width;
+public:
+	row_major_neighbours(const signed& width) : width(width) {}
+	inline T east(T const ptr) const { return ptr + 1; }
+	inline T west(T const ptr) const { return ptr - 1; }
+	inline T south(T const ptr) const { return ptr + width; }
+	inline T north(T const ptr) const { return ptr - width; }
+};
+
 /**
 	Develops an 1D avalanche. The helping avalanche container is not flushed, so it contains the whole avalanche afterwards.
 	Important: The cell at hint must be decreased by 1.
+	@param neighbours gives the neighbour cells in the grid's layout,
+		e.g. row_major_neighbours
 */
-template<class AvalancheContainer>
-// TODO: make hint ptr -> no grid class
-// TODO: use refs for ints?
-inline void avalanche_1d_hint_noflush(const signed& grid_width, AvalancheContainer& array,
-	typename AvalancheContainer::value_type hint) // TODO: hint is a const pointer!
+template<class Neighbours, class AvalancheContainer>
+inline void avalanche_1d_noflush(const Neighbours& neighbours, AvalancheContainer& array,
+	typename AvalancheContainer::value_type hint)
 {
 	*hint -= 4; // can be <0, so "*hint & 3" is not correct here
 	array.push(hint);
@@ -240,23 +367,23 @@ inline void avalanche_1d_hint_noflush(const signed& grid_width, AvalancheContain
 		using vt = typename AvalancheContainer::value_type;
 		vt const ptr = array.pop();
 
-		vt const ptr_e = ptr + 1;
+		vt const ptr_e = neighbours.east(ptr);
 		if(++*ptr_e > 3) {
 			*ptr_e&=3;
 			array.push(ptr_e);
 		}
-		vt const ptr_w = ptr - 1;
+		vt const ptr_w = neighbours.west(ptr);
 		if(++*ptr_w > 3) {
 			*ptr_w&=3;
 			array.push(ptr_w);
 		}
-		vt const ptr_s = ptr + grid_width;
+		vt const ptr_s = neighbours.south(ptr);
 		if(++*ptr_s > 3) {
 			*ptr_s&=3; // TODO: template variant with ==4 => = 0 ?
 			array.push(ptr_s);
 		}
 
-		vt const ptr_n = ptr - grid_width;
+		vt const ptr_n = neighbours.north(ptr);
 		if(++*ptr_n > 3) {
 			*ptr_n&=3;
 			array.push(ptr_n);
@@ -266,6 +393,21 @@ inline void avalanche_1d_hint_noflush(const signed& grid_width, AvalancheContain
 	array.write_to_file();
 }
 
+/**
+	Develops an 1D avalanche. The helping avalanche container is not flushed, so it contains the whole avalanche afterwards.
+	Important: The cell at hint must be decreased by 1.
+*/
+template<class AvalancheContainer>
+// TODO: make hint ptr -> no grid class
+// TODO: use refs for ints?
+inline void avalanche_1d_hint_noflush(const signed& grid_width, AvalancheContainer& array,
+	typename AvalancheContainer::value_type hint) // TODO: hint is a const pointer!
+{
+	using vt = typename AvalancheContainer::value_type;
+	avalanche_1d_noflush(row_major_neighbours<vt>(grid_width),
+		array, hint);
+}
+
 //! variant with @dim parameter instead of giving width as int
 template<class T, class AvalancheContainer>
 inline void avalanche_1d_hint_noflush(std::vector<T>& grid, const dimension& dim, const uint32_t hint, AvalancheContainer& array)
@@ -289,6 +431,76 @@ inline void avalanche_1d_hint_noflush_single(grid_t& grid, const point& hint, Av
 	internal::avalanche_1d_hint_noflush(grid.internal_dim().width(), array, &grid[hint]);
 }
 
+/**
+	@brief Keeps border cells from firing during many avalanches.
+
+	Border cells start at the minimum of the cell type and get at most one
+	grain per 1D avalanche. For narrow types like int8_t, they would
+	reach 4 after a few hundred 1D avalanches, so they are reset before.
+	@invariant the border has been reset at most max_waves waves ago
+*/
+template<class T>
+class border_guard
+{
+	//! half of the grains a border cell can take before it fires
+	static constexpr uint64_t max_waves =
+		(3 - (int64_t)std::numeric_limits<T>::min()) >> 1;
+	uint64_t waves = 0;
+public:
+	//! sets all border cells of @a grid to the minimum of T
+	static void reset(std::vector<T>& grid, const dimension& dim)
+	{
+		const unsigned w = dim.width(), h = dim.height();
+		std::fill_n(grid.begin(), w, std::numeric_limits<T>::min());
+		std::fill_n(grid.end() - w, w, std::numeric_limits<T>::min());
+		for(unsigned y = 1; y < h - 1; ++y)
+		 grid[y * w] = grid[y * w + w - 1] = std::numeric_limits<T>::min();
+	}
+
+	//! must be called after each 1D avalanche on @a grid
+	inline void count_wave(std::vector<T>& grid, const dimension& dim)
+	{
+		if(++waves == max_waves)
+		{
+			reset(grid, dim);
+			waves = 0;
+		}
+	}
+
+	//! like above, for a grid in @a layout, e.g. a tiled_layout
+	template<class Layout>
+	inline void count_wave(std::vector<T>& grid, const Layout& layout)
+	{
+		if(++waves == max_waves)
+		{
+			layout.reset_border(grid);
+			waves = 0;
+		}
+	}
+};
+
+//! returns whether all non-border cells of @a grid, which must be
+//! stable, can be stored as T while running l_hint()
+template<class T>
+inline bool fits_cell_type(const std::vector<int>& grid, const dimension& dim)
+{
+	for(unsigned i = 0; i < grid.size(); ++i)
+	 if(!is_border(dim, i) && (grid[i] < 0
+		|| grid[i] > std::numeric_limits<T>::max() - 4))
+	  return false;
+	return true;
+}
+
+//! copies @a grid into a grid of cell type T, with a border of T's minimum
+template<class T>
+inline std::vector<T> to_cell_type(const std::vector<int>& grid,
+	const dimension& dim)
+{
+	std::vector<T> result(grid.begin(), grid.end());
+	border_guard<T>::reset(result, dim);
+	return result;
+}
+
 /**
 	Develops an 1D avalanche. The helping avalanche container is flushed.
 	Important: The cell at hint must be decreased by 1.
@@ -305,37 +517,58 @@ inline void avalanche_1d_hint(std::vector<T>& grid, const dimension& dim, const
 	@param times Number of times that the cell at hint may fire. for times=INT_MAX, lx_hint = l_hint
 */
 template<class T, class AvalancheContainer>
-inline void lx_hint(std::vector<T>& grid, const dimension& dim, const uint32_t hint, AvalancheContainer& array, int times)
+inline void lx_hint(std::vector<T>& grid, const dimension& dim, const uint32_t hint, AvalancheContainer& array, int times,
+	border_guard<T>& guard)
 {
 	array.write_header((uint64_t)grid.data());
 	grid[hint]--;
 	for(;grid[hint]>2 && times > 0; times--)
 	{
 		avalanche_1d_hint(grid, dim, hint, array);
+		guard.count_wave(grid, dim);
 	}
 	array.write_separator();
 	grid[hint]++;
 }
 
+//! version for a grid whose border has just been set up
+template<class T, class AvalancheContainer>
+inline void lx_hint(std::vector<T>& grid, const dimension& dim, const uint32_t hint, AvalancheContainer& array, int times)
+{
+	border_guard<T> guard;
+	lx_hint(grid, dim, hint, array, times, guard);
+}
+
 /**
 	Develops a full avalanche and writes avalanche seperator afterwards.
 	@param array container of type array_stack or array_queue.
 		array_stack is faster (1-2 times), but array_queue can handle IO (instantly!).
+	@param guard must be kept over all calls on the same grid
 */
 template<class T, class AvalancheContainer>
-inline void l_hint(std::vector<T>& grid, const dimension& dim, const uint32_t hint, AvalancheContainer& array)
+inline void l_hint(std::vector<T>& grid, const dimension& dim, const uint32_t hint, AvalancheContainer& array,
+	border_guard<T>& guard)
 {
 	array.write_header((uint64_t)grid.data());
 	grid[hint]--;
 	while(grid[hint]>2)
-	{ // TODO: fit this for char types: all 128 rounds (lx_hint?)
+	{
 		avalanche_1d_hint(grid, dim, hint, array);
+		guard.count_wave(grid, dim);
 	//	avalanche_1d_hint_noflush_2<int>(grid, dim, hint/*, array, avalanche_fp*/);
 	}
 	array.write_separator();
 	grid[hint]++;
 }
 
+//! version for a grid whose border has just been set up
+template<class T, class AvalancheContainer>
+inline void l_hint(std::vector<T>& grid, const dimension& dim, const uint32_t hint, AvalancheContainer& array)
+{
+	border_guard<T> guard;
+	l_hint(grid, dim, hint, array, guard);
+}
+
 #if 0
 template<class AvalancheContainer>
 inline void l2_hint(std::vector<int>* grid, const dimension* dim, int hint, AvalancheContainer* array, FILE* avalanche_fp)
@@ -354,8 +587,11 @@ template<class T>
 using _fix_log_l = log_base<T>;
 template<class T>
 using _fix_log_s = log_nothing_base<T>;
+template<class T>
+using _fix_log_la = log_base<T, sca::io::async_writer>;
 using fix_log_l = _fix_log_l<int*>;
 using fix_log_s = _fix_log_s<int*>;
+using fix_log_la = _fix_log_la<int*>; //!< fix_log_l, written asynchronously
 
 /*
  * fix algorithms
@@ -364,15 +600,16 @@ using fix_log_s = _fix_log_s<int*>;
 template<class AvalancheContainer, class ResultType>
 inline void do_fix(/*std::vector<int>* grid,*/ const dimension& dim, AvalancheContainer& array, ResultType& result_logger)
 {
+	using vt = typename AvalancheContainer::value_type;
+	using cell_t = typename std::remove_pointer<vt>::type;
 	uint32_t fire_times;
-	const int INVERT_BIT = (1 << 31);
-	const int GRAIN_BITS = (-1) ^ INVERT_BIT;
+	const cell_t INVERT_BIT = std::numeric_limits<cell_t>::min();
+	const cell_t GRAIN_BITS = std::numeric_limits<cell_t>::max();
 
 //	result_logger.write_avalanche_counter();
 
 	do
 	{
-		using vt = typename AvalancheContainer::value_type;
 		vt const cur_element = array.pop(); // TODO!!
 		//printf("cur: %d\n",cur_element);
 
@@ -409,10 +646,13 @@ inline void do_fix(/*std::vector<int>* grid,*/ const dimension& dim, AvalancheCo
 /**
 	This is the alternative algorithm for sandpiles with many more than 3 grains.
 	Proposed by Sebastian Frehmel in his Diploma Thesis.
+	For cell types narrower than int, no cell may ever exceed the maximum
+	of T without the sign bit. This is guaranteed if the sum of all grains
+	is not larger (see fits_fix()).
 	@param result_logger Class of type FixLogL or FixLogS
 */
-template<class AvalancheContainer, class ResultType>
-inline void fix(std::vector<int>& grid, const dimension& dim, int hint, AvalancheContainer& array, ResultType& result_logger)
+template<class T, class AvalancheContainer, class ResultType>
+inline void fix(std::vector<T>& grid, const dimension& dim, int hint, AvalancheContainer& array, ResultType& result_logger)
 {
 	//printf("hint: %d\n",hint);
 	result_logger.write_header((uint64_t)grid.data());
@@ -428,10 +668,10 @@ inline void fix(std::vector<int>& grid, const dimension& dim, int hint, Avalanch
 // TODO: remove non-grid_t-versions everywhere
 
 //! version without a hint
-template<class AvalancheContainer, class ResultType>
-inline void fix(std::vector<int>& grid, const dimension& dim, AvalancheContainer& array, ResultType& result_logger)
+template<class T, class AvalancheContainer, class ResultType>
+inline void fix(std::vector<T>& grid, const dimension& dim, AvalancheContainer& array, ResultType& result_logger)
 {
-	const int INVERT_BIT = (1 << 31);
+	const T INVERT_BIT = std::numeric_limits<T>::min();
 
 	result_logger.write_header((uint64_t)grid.data());
 	for(unsigned int count = 0; count < dim.area(); ++count)
@@ -447,6 +687,21 @@ inline void fix(std::vector<int>& grid, const dimension& dim, AvalancheContainer
 	do_fix(dim, array, result_logger);
 }
 
+//! returns whether fix() can run on a copy of @a grid with cell type T
+template<class T>
+inline bool fits_fix(const std::vector<int>& grid, const dimension& dim)
+{
+	int64_t grains = 0;
+	for(unsigned i = 0; i < grid.size(); ++i)
+	 if(!is_border(dim, i))
+	{
+		if(grid[i] < 0)
+		 return false;
+		grains += grid[i];
+	}
+	return grains <= std::numeric_limits<T>::max();
+}
+
 }
 
 #endif // STACK_ALGORITHM_H
@@ -0,0 +1,205 @@
+/*************************************************************************/
+/* sca toolsuite - a toolsuite to simulate cellular automata.            */
+/* Copyright (C) 2011-2014                                               */
+/* Johannes Lorenz                                                       */
+/* https://github.com/JohannesLorenz/sca-toolsuite                       */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#ifndef TILED_GRID_H
+#define TILED_GRID_H
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "stack_algorithm.h"
+
+namespace sandpile
+{
+
+template<class T, unsigned TileBits>
+class tiled_neighbours;
+
+/**
+	@brief Memory layout storing a grid in square tiles.
+
+	Each tile has 2^TileBits x 2^TileBits cells, which are row-major, and
+	the tiles are row-major, too. The grid (border included) is padded
+	with cells of the minimal value to full tiles, and these cells are
+	never touched.
+
+	For avalanches on grids much larger than the cache, the north and
+	south neighbours are usually in the cache lines of the same tile,
+	while in row-major grids, they are one whole row away.
+*/
+template<unsigned TileBits = 4>
+class tiled_layout
+{
+public:
+	static constexpr unsigned side = 1u << TileBits;
+	static constexpr unsigned mask = side - 1;
+private:
+	const dimension dim; //!< row-major dimension, border included
+	const unsigned tiles_x, tiles_y;
+public:
+	//! @param dim internal dimension of the row-major grid
+	tiled_layout(const dimension& dim) :
+		dim(dim),
+		tiles_x((dim.width() + mask) >> TileBits),
+		tiles_y((dim.height() + mask) >> TileBits)
+	{}
+
+	//! number of cells, padding included
+	std::size_t size() const {
+		return (std::size_t)tiles_x * tiles_y << (2 * TileBits);
+	}
+
+	//! distance between a cell and the same cell in the tile below
+	std::ptrdiff_t tile_row() const {
+		return (std::ptrdiff_t)tiles_x << (2 * TileBits);
+	}
+
+	std::size_t index(unsigned x, unsigned y) const
+	{
+		const std::size_t tile = (std::size_t)(y >> TileBits) * tiles_x
+			+ (x >> TileBits);
+		return (((tile << TileBits) | (y & mask)) << TileBits)
+			| (x & mask);
+	}
+
+	//! converts an index of the row-major grid
+	std::size_t index(std::size_t row_major) const {
+		return index(row_major % dim.width(), row_major / dim.width());
+	}
+
+	template<class T>
+	std::vector<T> to_tiled(const std::vector<T>& grid) const
+	{
+		std::vector<T> tiled(size(), std::numeric_limits<T>::min());
+		const T* row = grid.data();
+		for(unsigned y = 0; y < dim.height(); ++y, row += dim.width())
+		for(unsigned x = 0; x < dim.width(); ++x)
+		 tiled[index(x, y)] = row[x];
+		return tiled;
+	}
+
+	template<class T>
+	void from_tiled(const std::vector<T>& tiled,
+		std::vector<T>& grid) const
+	{
+		T* row = grid.data();
+		for(unsigned y = 0; y < dim.height(); ++y, row += dim.width())
+		for(unsigned x = 0; x < dim.width(); ++x)
+		 row[x] = tiled[index(x, y)];
+	}
+
+	//! like border_guard::reset(), for a grid in this layout
+	template<class T>
+	void reset_border(std::vector<T>& tiled) const
+	{
+		const unsigned w = dim.width(), h = dim.height();
+		for(unsigned x = 0; x < w; ++x)
+		 tiled[index(x, 0)] = tiled[index(x, h - 1)]
+			= std::numeric_limits<T>::min();
+		for(unsigned y = 1; y < h - 1; ++y)
+		 tiled[index(0, y)] = tiled[index(w - 1, y)]
+			= std::numeric_limits<T>::min();
+	}
+
+	//! @param base the first cell of the tiled grid
+	template<class T>
+	tiled_neighbours<T, TileBits> neighbours(T const base) const {
+		return tiled_neighbours<T, TileBits>(base, tile_row());
+	}
+};
+
+//! neighbour access for grids in a tiled_layout,
+//! see internal::avalanche_1d_noflush()
+template<class T, unsigned TileBits>
+class tiled_neighbours
+{
+	static constexpr unsigned side = tiled_layout<TileBits>::side;
+	static constexpr unsigned mask = tiled_layout<TileBits>::mask;
+	//! distance between the last cell of a tile row and the first
+	//! one of the next tile
+	static constexpr std::ptrdiff_t next_tile = side * side - mask;
+
+	T const base;
+	const std::ptrdiff_t tile_row;
+	std::size_t x(T const ptr) const { return (ptr - base) & mask; }
+	std::size_t y(T const ptr) const {
+		return ((ptr - base) >> TileBits) & mask;
+	}
+public:
+	tiled_neighbours(T const base, std::ptrdiff_t tile_row) :
+		base(base), tile_row(tile_row) {}
+	inline T east(T const ptr) const {
+		return (x(ptr) != mask) ? ptr + 1 : ptr + next_tile;
+	}
+	inline T west(T const ptr) const {
+		return x(ptr) ? ptr - 1 : ptr - next_tile;
+	}
+	inline T south(T const ptr) const {
+		return (y(ptr) != mask) ? ptr + side
+			: ptr + tile_row - mask * side;
+	}
+	inline T north(T const ptr) const {
+		return y(ptr) ? ptr - side : ptr - tile_row + mask * side;
+	}
+};
+
+//! l_hint() for a grid in a tiled_layout
+//! @param hint index in the tiled grid
+template<class T, unsigned TileBits, class AvalancheContainer>
+inline void l_hint(std::vector<T>& grid,
+	const tiled_layout<TileBits>& layout, const std::size_t hint,
+	AvalancheContainer& array, border_guard<T>& guard)
+{
+	const tiled_neighbours<T*, TileBits> neighbours
+		= layout.neighbours(grid.data());
+	array.write_header((uint64_t)grid.data());
+	grid[hint]--;
+	while(grid[hint]>2)
+	{
+		internal::avalanche_1d_noflush(neighbours, array, &grid[hint]);
+		array.flush();
+		guard.count_wave(grid, layout);
+	}
+	array.write_separator();
+	grid[hint]++;
+}
+
+//! drop sequence @a Drops, but with indices of a tiled_layout
+template<class Drops, unsigned TileBits>
+class tiled_drops
+{
+	Drops drops;
+	const tiled_layout<TileBits>& layout;
+public:
+	tiled_drops(const Drops& drops, const tiled_layout<TileBits>& layout) :
+		drops(drops), layout(layout) {}
+	inline bool next(unsigned& idx)
+	{
+		if(!drops.next(idx))
+		 return false;
+		idx = layout.index(idx);
+		return true;
+	}
+};
+
+}
+
+#endif // TILED_GRID_H
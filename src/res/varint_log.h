@@ -0,0 +1,197 @@
+/*************************************************************************/
+/* sca toolsuite - a toolsuite to simulate cellular automata.            */
+/* Copyright (C) 2011-2014                                               */
+/* Johannes Lorenz                                                       */
+/* https://github.com/JohannesLorenz/sca-toolsuite                       */
+/*                                                                       */
+/* This program is free software; you can redistribute it and/or modify  */
+/* it under the terms of the GNU General Public License as published by  */
+/* the Free Software Foundation; either version 3 of the License, or (at */
+/* your option) any later version.                                       */
+/* This program is distributed in the hope that it will be useful, but   */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of            */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU      */
+/* General Public License for more details.                              */
+/*                                                                       */
+/* You should have received a copy of the GNU General Public License     */
+/* along with this program; if not, write to the Free Software           */
+/* Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA  */
+/*************************************************************************/
+
+#ifndef VARINT_LOG_H
+#define VARINT_LOG_H
+
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+#include <type_traits>
+
+#include "stack_algorithm.h"
+
+namespace sandpile
+{
+
+/*
+ * compressed avalanche logs
+ *
+ * The header is the one of log_base, with an index size of 0.
+ * Then follow varints (LEB128). 0 is the avalanche separator, any other
+ * value v is 1 + zigzag(idx - last idx), with idx being the internal
+ * cell index. Topplings are local, so most values take 1 or 2 bytes,
+ * instead of 8 for a pointer.
+ */
+
+/**
+	@brief Logging class writing compressed logs, see above.
+
+	The output is buffered in blocks, so it must be flushed by
+	destruction.
+*/
+template<class T>
+class log_varint
+{
+	static_assert(std::is_pointer<T>::value,
+		"log_varint can only log pointers to cells");
+	static constexpr std::size_t block_size = 1 << 16;
+	FILE* fp;
+	std::vector<uint8_t> block;
+	uint64_t grid_offset = 0;
+	int64_t last = 0;
+	bool header_written = false;
+
+	inline void put_varint(uint64_t val)
+	{
+		for(; val >= 0x80; val >>= 7)
+		 block.push_back((uint8_t)(val | 0x80));
+		block.push_back((uint8_t)val);
+		if(block.size() >= block_size)
+		 write_block();
+	}
+
+	inline void put_index(const T elem)
+	{
+		const int64_t idx = elem - (T)grid_offset;
+		const int64_t delta = idx - last;
+		last = idx;
+		put_varint((((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63)) + 1);
+	}
+
+	void write_block()
+	{
+		fwrite(block.data(), 1, block.size(), fp);
+		block.clear();
+	}
+public:
+	log_varint(FILE* fp) : fp(fp) { block.reserve(block_size + 10); }
+	~log_varint() { write_block(); }
+	log_varint(const log_varint&) = delete;
+
+	//! writes out the current block
+	void sync() { write_block(); fflush(fp); }
+	//! the delta coding state
+	int64_t last_index() const { return last; }
+	//! continues a log which has been written up to @a last_idx
+	void resume(int64_t last_idx)
+	{
+		last = last_idx;
+		header_written = true;
+	}
+
+	inline void write_separator() { put_varint(0); }
+	//! only the first call writes the header
+	inline void write_header(uint64_t offset)
+	{
+		grid_offset = offset;
+		if(!header_written)
+		{
+			static const char hdr[16] = {}; // index size 0, div size 0
+			fwrite(hdr, sizeof(hdr), 1, fp);
+			const uint64_t zero = 0;
+			fwrite(&zero, sizeof(uint64_t), 1, fp);
+			header_written = true;
+		}
+	}
+	inline void write_elem_to_file(const T elem, const uint32_t* const ntimes) {
+		for(uint32_t i = 0; i < *ntimes; i++)
+		 put_index(elem);
+	}
+	inline void write_array_to_file(T* const ptr, const int num) {
+		for(int i = 0; i < num; ++i)
+		 put_index(ptr[i]);
+	}
+};
+
+//! like _array_queue, but writing compressed logs
+template<class T>
+class _array_queue_varint : public _array_queue_base<T>, public log_varint<T>
+{
+	typedef _array_queue_base<T> base;
+public:
+	inline _array_queue_varint(unsigned human_grid_size, FILE* fp) :
+		base(human_grid_size),
+		log_varint<T>(fp) {}
+
+	// logging:
+	inline void write_to_file() {
+		log_varint<T>::write_array_to_file(
+			base::array+1, base::write_ptr - base::array);
+	}
+};
+
+typedef _array_queue_varint<int*> array_queue_varint;
+
+template<class T>
+using _fix_log_v = log_varint<T>;
+using fix_log_v = _fix_log_v<int*>;
+
+/**
+	@brief Reads compressed logs after the header.
+
+	The header must have been read already.
+*/
+class varint_log_reader
+{
+	FILE* const fp;
+	int64_t last = 0;
+	//! reads one varint, returns false on eof
+	bool get_varint(uint64_t& val)
+	{
+		val = 0;
+		for(int shift = 0; shift < 64; shift += 7)
+		{
+			const int c = getc(fp);
+			if(c == EOF)
+			{
+				if(shift)
+				 throw "Compressed avalanche log is truncated";
+				return false;
+			}
+			val |= (uint64_t)(c & 0x7f) << shift;
+			if(!(c & 0x80))
+			 return true;
+		}
+		throw "Corrupt varint in compressed avalanche log";
+	}
+public:
+	varint_log_reader(FILE* fp) : fp(fp) {}
+
+	enum class token_t { index, separator, eof };
+
+	//! @param idx is set to the internal index for token_t::index
+	token_t next(int64_t& idx)
+	{
+		uint64_t val;
+		if(!get_varint(val))
+		 return token_t::eof;
+		if(!val)
+		 return token_t::separator;
+		--val;
+		last += (int64_t)((val >> 1) ^ -(val & 1));
+		idx = last;
+		return token_t::index;
+	}
+};
+
+}
+
+#endif // VARINT_LOG_H
@@ -25,6 +25,7 @@
 #include "general.h"
 #include "io.h"
 #include "rotor_algorithm.h"
+#include "parallel_rotor.h"
 #include "asm_basic.h"
 
 template<class AvalancheContainer, class Logger>
@@ -48,6 +49,15 @@ void run(grid_t& grid, grid_t& chips, int hint=-1)
 	 rotor::rotor_fix(grid, chips, human2internal(hint, grid.internal_dim().width()), container, logger);
 }
 
+//! like run() with a hint, but with packed cells, which is faster
+template<class Logger>
+void run_packed(grid_t& grid, grid_t& chips, int hint)
+{
+	sandpile::_array_stack<rotor::packed_cell*> container(grid.human_dim().area());
+	Logger logger(stdout);
+	rotor::packed_rotor_fix(grid, chips, human2internal(hint, grid.internal_dim().width()), container, logger);
+}
+
 class MyProgram : public Program
 {
 	exit_t main()
@@ -61,7 +71,8 @@ class MyProgram : public Program
 			case 4: hint = atoi(argv[3]);
 			case 3: shell_command = argv[2];
 				output_type = argv[1][0];
-				if(argv[1][1] || !(output_type=='l'||output_type=='s'))
+				if(argv[1][1] || !(output_type=='l'||output_type=='s'
+					||output_type=='p'))
 				 exit_usage();
 				break;
 			default:
@@ -72,7 +83,7 @@ class MyProgram : public Program
 	//	dimension dim;
 
 		//read_grid(read_fp, &grid, &dim);
-		grid_t grid(read_fp, 1);
+		grid_t grid(read_fp, 1, std::numeric_limits<int>::min());
 	/*	for(unsigned int i=0;i<dim.area();i++)
 		 if(!is_border(dim, i))
 		  grid[i]&=3;*/
@@ -94,9 +105,18 @@ class MyProgram : public Program
 			// TODO: int or int*?
 			case 'l': ::run<sandpile::_array_stack<int>, sandpile::_fix_log_l<int>>(grid, chips, hint); break;
 			case 's':
-				::run<sandpile::_array_stack<int>, sandpile::_fix_log_s<int>>(grid, chips, hint);
+				if(hint == -1)
+				 ::run<sandpile::_array_stack<int>, sandpile::_fix_log_s<int>>(grid, chips, hint);
+				else
+				 ::run_packed<sandpile::_fix_log_s<int>>(grid, chips, hint);
 				std::cout << grid;
 				break;
+			case 'p': {
+				const int threads = hint; // 3rd param for p
+				assert_usage(threads > 0);
+				rotor::parallel_rotor_fix(grid, chips, threads);
+				std::cout << grid;
+			}	break;
 		}
 
 		return exit_t::success;
@@ -108,10 +128,14 @@ int main(int argc, char** argv)
 	HelpStruct help;
 	help.description = "Runs the rotor router algorithm until all chips are out.";
 	help.input = "arrow grid";
-	help.syntax = "rotor/rotor s|l <shell command> [<hint>]";
+	help.syntax = "rotor/rotor s|l <shell command> [<hint>]\n"
+		"rotor/rotor p <shell command> <threads>";
 	help.add_param("s|l", "s calculates resulting arrows, l the number each arrow fires");
 	help.add_param("<shell command>", "calculates chip configuration to add");
 	help.add_param("<hint>", "only ensures that arrow at hint will be fired");
+	help.add_param("p", "like s, but runs the chips of all cells on multiple threads;\n"
+		"   for chips on one cell, equal to s with this cell as hint");
+	help.add_param("<threads>", "number of threads for p");
 
 	MyProgram program;
 	return program.run(argc, argv, &help);
@@ -44,6 +44,9 @@ call_test "Testing the math/coords script" 1 "core/create 2 2 0 | math/add `./ma
 
 call_test "Testing io/scat" 1 "core/create 8 8 1| io/scat | core/all_equals 1"
 call_test "Testing io/field_to_seq, io/seq_to_field" 1 "core/create 8 8 8| io/field_to_seq | io/seq_to_field 8 8 | core/all_equals 8"
+call_test "Testing io/field_to_seq binary" 1 "core/create 8 8 8 | io/field_to_seq binary | io/seq_to_field 8 8 | core/all_equals 8"
+call_test "Testing io/field_to_seq varint" 1 "core/create 8 8 0 | math/add 63 0 5 | io/field_to_seq varint | io/seq_to_field 8 8 | core/diff2 'core/create 8 8 0 | math/add 63 0 5'"
+call_test "Testing io/field_to_seq (large pipe)" 1 "core/create 100 100 0 | math/equation '(x*y)%37' | io/field_to_seq varint | io/seq_to_field 100 100 | core/diff2 \"core/create 100 100 0 | math/equation '(x*y)%37'\""
 
 call_test "Testing math/equation for rows (1)" 1 "core/create 4 4 1 | math/equation 'x>=2&&x<=1' | core/all_equals 0"
 call_test "Testing math/equation for rows (2)" 1 "core/create 4 4 1 | math/equation 'x>=0&&x<=3'  | core/all_equals 1"
@@ -56,8 +59,8 @@ call_test "Testing math/equation for valmax (2)" 1 "core/create 4 4 1 | math/equ
 call_test "Testing math/equation for valeq (1)" 1 "core/create 4 4 1 | math/equation 'v==1' | core/all_equals 1"
 call_test "Testing math/equation for valeq (2)" 1 "core/create 4 4 1 | math/equation 'v==0' | core/all_equals 0"
 
-call_test "Testing io/avalanches_bin2human" 1 "printf \"\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x04\x01\x00\x00\x00\x00\x00\x00\x00\x00\x05\x00\x00\x00\x06\x00\x00\x00\x09\x00\x00\x00\x0a\x00\x00\x00\"  | io/avalanches_bin2human 2 | io/seq_to_field 2 2 | core/all_equals 1"
-call_test "Testing io/avalanches_bin2human with ids" 1 "printf \"\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x04\x01\x00\x00\x00\x00\x00\x00\x00\x00\x05\x00\x00\x00\x09\x00\x00\x00\x0a\x00\x00\x00\"  | io/avalanches_bin2human 2 ids | io/seq_to_field 2 2 | core/all_equals 1"
+call_test "Testing io/avalanches_bin2human" 1 "printf \"\000\000\000\000\000\000\000\000\000\000\000\000\000\000\004\001\000\000\000\000\000\000\000\000\005\000\000\000\006\000\000\000\011\000\000\000\012\000\000\000\"  | io/avalanches_bin2human 2 | io/seq_to_field 2 2 | core/all_equals 1"
+call_test "Testing io/avalanches_bin2human with ids" 1 "printf \"\000\000\000\000\000\000\000\000\000\000\000\000\000\000\004\001\000\000\000\000\000\000\000\000\005\000\000\000\011\000\000\000\012\000\000\000\"  | io/avalanches_bin2human 2 ids | io/seq_to_field 2 2 | core/all_equals 1"
 
 call_test "Testing algo/fix s" 1 "core/create 4 4 8 | algo/fix s | core/all_equals 2"
 call_test "Testing algo/fix s hint" 1 "core/create 4 4 8 | algo/fix s 0 | core/all_equals 2"
@@ -68,15 +71,25 @@ EQ_3_P_1='((x==y||x==8-y)&&v==1)||(x==4&&y==4&&v==0)||(x!=y&&x!=8-y&&v==3)'
 
 call_test "Testing algo/fix s (2)" 1 "core/create 9 9 3 | math/add `./math/coords 9 4 4` | algo/fix s | math/equation \$EQ_3_P_1 | core/all_equals 1"
 call_test "Testing algo/fix l (2)" 1 "core/create 9 9 3 | math/add `./math/coords 9 4 4` | algo/fix l `./math/coords 9 4 4` | io/avalanches_bin2human 9 | io/seq_to_field 9 9  | math/equation 'v-min(min(x+1,9-x),min(y+1,9-y))' | core/all_equals 0"
+call_test "Testing algo/fix v" 1 "core/create 9 9 5 | algo/fix v | io/avalanches_bin2human 9 | io/seq_to_field 9 9 | core/diff2 'core/create 9 9 5 | algo/fix l | io/avalanches_bin2human 9 | io/seq_to_field 9 9'"
+call_test "Testing algo/fix p" 1 "core/create 9 9 3 | math/add `./math/coords 9 4 4` | algo/fix p 3 | math/equation \$EQ_3_P_1 | core/all_equals 1"
+call_test "Testing algo/fix p (2)" 1 "core/create 31 17 9 | math/add `./math/coords 31 3 5` | algo/fix p 4 | core/diff2 'core/create 31 17 9 | math/add `./math/coords 31 3 5` | algo/fix s'"
+call_test "Testing algo/fix s (least action)" 1 "core/create 41 41 0 | math/equation '(x==20&&y==20)*30000+(x==3&&y==5)*8000' | algo/fix s | core/diff2 \"core/create 41 41 0 | math/equation '(x==20&&y==20)*30000+(x==3&&y==5)*8000' | algo/fix p 2\""
+call_test "Testing algo/fix s (int8_t cells)" 1 "core/create 5 5 0 | math/equation '(x==2&&y==2)*100' | algo/fix s 12 | core/diff2 \"core/create 5 5 0 | math/equation '(x==2&&y==2)*100' | algo/fix p 1\""
+call_test "Testing algo/fix s (int16_t cells)" 1 "core/create 9 9 5 | math/add `./math/coords 9 4 4` | algo/fix s | core/diff2 'core/create 9 9 5 | math/add `./math/coords 9 4 4` | algo/fix p 1'"
+call_test "Testing algo/fix c" 1 "core/create 3 3 4 | algo/fix c | grep -qx 'grains: 36'"
 call_test "Testing algo/fix (special)" 1 "core/create 3 3 4 | algo/relax s `./math/coords 3 1 1` 0 | core/all_equals 4"
 
 call_test "Testing algo/relax s" 1 "core/create 9 9 3 | math/add `./math/coords 9 4 4` | algo/relax s | math/equation \$EQ_3_P_1 | core/all_equals 1"
 call_test "Testing algo/relax l" 1 "core/create 9 9 3 | math/add `./math/coords 9 4 4` | algo/relax l `./math/coords 9 4 4` | io/avalanches_bin2human 9 | io/seq_to_field 9 9  | math/equation 'v-min(min(x+1,9-x),min(y+1,9-y))' | core/all_equals 0"
+call_test "Testing algo/relax v" 1 "core/create 9 9 3 | math/add `./math/coords 9 4 4` | algo/relax v `./math/coords 9 4 4` | io/avalanches_bin2human 9 | io/seq_to_field 9 9  | math/equation 'v-min(min(x+1,9-x),min(y+1,9-y))' | core/all_equals 0"
+call_test "Testing algo/relax batch/each" 1 "(core/create 9 9 3; echo; echo 40 3 40 80) | algo/relax each s | core/diff2 'core/create 9 9 3 | algo/relax batch s 40,40,80,3'"
+call_test "Testing algo/relax batch l" 1 "core/create 9 9 3 | algo/relax batch l 40,40,80,3 | io/avalanches_bin2human 9 | io/seq_to_field 9 9 | core/diff2 'core/create 9 9 3 | math/add 40 | math/add 40 | math/add 80 | math/add 3 | algo/fix l | io/avalanches_bin2human 9 | io/seq_to_field 9 9'"
 
-call_test "Testing math/calc (1)" 1 "[ `echo 0 | math/calc '!0&&1==1&&1!=0&&1>=1&&1<=1&&!(1<1)&&!(1>1)&&1+1==+2&&1-4==-3&&8%3==2&&2*2==4&&9/3==3&&(0||1)==1&&(0||0)==0&&min(3,2)==2&&min(2,3)==2&&max(2,3)==3&&max(3,2)==3'` == '1' ]"
+call_test "Testing math/calc (1)" 1 "[ `echo 0 | math/calc '!0&&1==1&&1!=0&&1>=1&&1<=1&&!(1<1)&&!(1>1)&&1+1==+2&&1-4==-3&&8%3==2&&2*2==4&&9/3==3&&(0||1)==1&&(0||0)==0&&min(3,2)==2&&min(2,3)==2&&max(2,3)==3&&max(3,2)==3'` = '1' ]"
 call_test "Testing math/calc (2)" 1 "core/create 2 2 0 | math/add 0 1 2 | io/field_to_seq | math/calc 'x+1' | io/seq_to_field 2 2 | math/add 0 | core/all_equals 1"
-call_test "Testing math/calc (3)" 1 "[ `echo 0 | math/calc 'x?42:2014'` == '2014' ]"
-call_test "Testing math/calc (4)" 1 "[ `echo 1 | math/calc 'x?42:2014'` == '42' ]"
+call_test "Testing math/calc (3)" 1 "[ `echo 0 | math/calc 'x?42:2014'` = '2014' ]"
+call_test "Testing math/calc (4)" 1 "[ `echo 1 | math/calc 'x?42:2014'` = '42' ]"
 
 call_test "Testing math/comb add" 1 "core/create 2 2 1 | math/comb add \"core/create 2 2 2\" | core/all_equals 3"
 call_test "Testing math/comb sub" 1 "core/create 2 2 1 | math/comb sub \"core/create 2 2 2\" | core/all_equals -1"
@@ -84,6 +97,10 @@ call_test "Testing math/comb min" 1 "core/create 2 2 1 | math/comb min \"core/cr
 call_test "Testing math/comb max" 1 "core/create 2 2 1 | math/comb max \"core/create 2 2 2\" | core/all_equals 2"
 
 call_test "Testing algo/id" 1 "core/create 64 64 3 | math/comb add \"algo/id 64 64\" | algo/fix s | core/all_equals 3"
+call_test "Testing algo/id (sweep vs. stack)" 1 "algo/id 33 20 | core/diff2 \"core/create 33 20 6 | algo/fix s | math/equation '6-v' | algo/fix s\""
+call_test "Testing algo/id (sweep, wide)" 1 "algo/id 77 9 | core/diff2 \"core/create 77 9 6 | algo/fix s | math/equation '6-v' | algo/fix s\""
+call_test "Testing algo/id (sweep vs. parallel)" 1 "algo/id 33 20 | core/diff2 algo/id 33 20 2"
+call_test "Testing algo/id_cache" 1 "rm -rf tmp_idc && mkdir tmp_idc && algo/id_cache tmp_idc 14 15 9 10 && SCA_IDENTITY_CACHE=tmp_idc algo/id 15 9 | core/diff2 algo/id 15 9"
 
 call_test "Testing algo/S" 1 "core/create 9 9 3 | math/add `./math/coords 9 4 4` | algo/S | math/equation \$EQ_3_P_1 | core/all_equals 1"
 call_test "Testing algo/L" 1 "core/create 9 9 3 | math/add `./math/coords 9 4 4` | algo/L 9 `./math/coords 9 4 4` | io/seq_to_field 9 9  | math/equation 'v-min(min(x+1,9-x),min(y+1,9-y))' | core/all_equals 0"
@@ -93,22 +110,50 @@ call_test "Testing algo/L" 1 "core/create 9 9 3 | math/add `./math/coords 9 4 4`
 call_test "Testing algo/throw" 1 "core/create 9 9 3 | algo/throw `./math/coords 9 4 4` | math/equation \$EQ_3_P_1 | core/all_equals 1"
 
 call_test "Testing algo/burning_test" 1 "core/create 2 2 3 | algo/burning_test | io/avalanches_bin2human 2 | io/seq_to_field 2 2 | core/all_equals 1"
-call_test "Testing algo/is_recurrent (1)" 1 "[ `core/create 10 10 2 | algo/is_recurrent` == 'recurrent' ]"
-call_test "Testing algo/is_recurrent (2)" 1 "[ `core/create 10 10 1 | algo/is_recurrent` == 'transient' ]"
+call_test "Testing algo/burning_test batch" 1 "test \"\$( (core/create 6 4 3; echo; core/create 6 4 1; echo; core/create 1 3 2) | algo/burning_test batch 2 | paste -s -d, -)\" = recurrent,transient,recurrent"
+call_test "Testing algo/is_recurrent (1)" 1 "[ `core/create 10 10 2 | algo/is_recurrent` = 'recurrent' ]"
+call_test "Testing algo/is_recurrent (2)" 1 "[ `core/create 10 10 1 | algo/is_recurrent` = 'transient' ]"
 
 call_test "Testing algo/random_throw (input)" 1 "core/create 9 9 3 | math/add `./math/coords 9 4 4` | io/field_to_seq | algo/random_throw input 9 9 s | math/equation \$EQ_3_P_1 | core/all_equals 1"
+call_test "Testing algo/random_throw (binary input)" 1 "core/create 9 9 3 | math/add `./math/coords 9 4 4` | io/field_to_seq varint | algo/random_throw input 9 9 s | math/equation \$EQ_3_P_1 | core/all_equals 1"
+call_test "Testing algo/random_throw (usage)" 1 "algo/random_throw 2>&1 | grep -q ^Usage"
 call_test "Testing algo/random_throw (random)" 1 "core/create 9 9 0 | algo/random_throw random 1 42 | math/equation 'v<=1' | core/all_equals 1"
+call_test "Testing algo/random_throw (seed)" 1 "core/create 9 9 0 | algo/random_throw random 1000 5 | core/diff2 'core/create 9 9 0 | algo/random_throw random 1000 5'"
+call_test "Testing algo/random_throw (many grains)" 1 "core/create 3 3 0 | algo/random_throw random 20000 42 | math/equation 'v<=3' | core/all_equals 1"
+call_test "Testing algo/random_throw (records)" 1 "core/create 3 3 3 | algo/random_throw random 1 7 r | cut -d' ' -f2,4- | grep -qx '9 0 0 3 3'"
+call_test "Testing algo/random_throw (histograms)" 1 "core/create 5 5 0 | algo/random_throw random 500 3 h | sed -n '2,/^# area/p' | awk '/^[0-9]/ { s += \$2 } END { exit s != 500 }'"
+call_test "Testing algo/random_throw (counters)" 1 "core/create 3 3 3 | algo/random_throw random 1 7 c | grep -qx 'topples: 90000.0'"
+call_test "Testing algo/random_throw (resume)" 1 "core/create 9 9 0 | algo/random_throw random 2000 5 s tmp_ck.bin 700 0 > /dev/null && algo/random_throw resume tmp_ck.bin | core/diff2 'core/create 9 9 0 | algo/random_throw random 2000 5'"
+call_test "Testing algo/random_throw (resume log)" 1 "core/create 9 9 0 | algo/random_throw random 2000 5 r tmp_ck.bin 700 0 > tmp_r.txt && cp tmp_r.txt tmp_r2.txt && algo/random_throw resume tmp_ck.bin >> tmp_r2.txt && cmp tmp_r.txt tmp_r2.txt"
+call_test "Testing algo/random_throw (ensemble)" 1 "core/create 9 9 1 | algo/random_throw ensemble 500 5 3 2 | sed -n '11,19p' | core/diff2 'core/create 9 9 1 | algo/random_throw random 500 6'"
+call_test "Testing algo/random_throw (ensemble histograms)" 1 "core/create 5 5 0 | algo/random_throw ensemble 100 3 4 3 h | sed -n '2,/^# area/p' | awk '/^[0-9]/ { s += \$2 } END { exit s != 400 }'"
+call_test "Testing algo/random_throw (parallel)" 1 "core/create 20 20 2 | algo/random_throw parallel 5000 5 3 | core/diff2 'core/create 20 20 2 | algo/random_throw random 5000 5'"
+call_test "Testing algo/random_throw (parallel log)" 1 "core/create 20 20 2 | algo/random_throw parallel 2000 5 2 v | io/avalanches_bin2human 20 ids > tmp_p.txt && core/create 20 20 2 | algo/random_throw random 2000 5 l | io/avalanches_bin2human 20 ids | cmp tmp_p.txt -"
+call_test "Testing algo/random_throw (tiled)" 1 "core/create 37 23 0 | SCA_TILED_LAYOUT=always algo/random_throw random 5000 3 | core/diff2 'core/create 37 23 0 | SCA_TILED_LAYOUT=never algo/random_throw random 5000 3'"
 
 call_test "Testing io/to_tga (0=green, 3=red)" 1 "algo/id 50 50 | io/to_tga 00ff00 ff0000 > /dev/null"
 
 call_test "Testing algo/super (1)" 1 "core/create 2 2 2 | algo/super | core/all_equals 0"
 call_test "Testing algo/super (2)" 1 "core/create 2 2 3 | algo/super | core/all_equals 1"
+call_test "Testing algo/super (threads)" 1 "core/create 12 9 5 | algo/super 3 | core/diff2 'core/create 12 9 5 | algo/super'"
+call_test "Testing algo/aggregate s" 1 "algo/aggregate s 1000 41 41 | core/diff2 \"core/create 41 41 0 | math/equation '(x==20&&y==20)*1000' | algo/fix s\""
+call_test "Testing algo/aggregate r" 1 "algo/aggregate r 500 | awk '{ for(i = 1; i <= NF; ++i) n += (\$i >= 0) } END { exit n != 500 }'"
+call_test "Testing algo/aggregate r (rotors)" 1 "printf -- '-1 0 -1 -1\n0 1 1 0\n-1 0 -1 -1\n' > test.txt && algo/aggregate r 6 | core/diff2 'cat test.txt'"
+
+# bench
+call_test "Testing bench/compare" 1 "printf '# name\tunit\treps\tmedian\tmad\nfix\ts\t5\t1.00\t0.01\nid\ts\t5\t2.00\t0.02\n' > tmp_b1.txt && printf 'fix\ts\t5\t1.04\t0.01\nid\ts\t5\t1.90\t0.01\n' > tmp_b2.txt && printf 'fix\ts\t5\t1.04\t0.01\nid\ts\t5\t2.50\t0.01\n' > tmp_b3.txt && bench/compare tmp_b1.txt tmp_b2.txt > /dev/null && { bench/compare tmp_b1.txt tmp_b3.txt > /dev/null; test \$? -eq 1; }"
 
 # ca
 call_test "Testing ca/ca (1)" 1 "core/create 20 20 0 | ca/ca 'v:=v+2' end 4 | core/all_equals 8"
 call_test "Testing ca/ca (2)" 1 "core/create 20 20 4 | ca/ca 'v:=v+(-4*(v>=4))+(a[-1,0]>=4)+(a[0,-1]>=4)+(a[1,0]>=4)+(a[0,1]>=4)' | core/diff2 'core/create 20 20 4 | algo/S'"
+call_test "Testing ca/ca (3)" 1 "core/create 30 30 0 | math/equation '(x==15&&y==15)*200' > test.txt && ca/ca 'v:=v+(-4*(v>=4))+(a[-1,0]>=4)+(a[0,-1]>=4)+(a[1,0]>=4)+(a[0,1]>=4)' < test.txt | core/diff2 'algo/fix s < test.txt'"
+call_test "Testing ca/ca (async)" 1 "core/create 20 20 0 | ca/ca 'v:=min(v+1,3)' end 1000 async 5 | core/all_equals 3"
+call_test "Testing ca/ca (async seed)" 1 "core/create 20 20 0 | ca/ca 'v:=min(v+1,3)' end 3 async 5 > test.txt && core/create 20 20 0 | ca/ca 'v:=min(v+1,3)' end 3 async 5 | cmp test.txt - && ! core/create 20 20 0 | ca/ca 'v:=min(v+1,3)' end 3 async 6 | cmp -s test.txt -"
+call_test "Testing ca/ca (threads)" 1 "core/create 60 60 0 | math/equation '(x*7+y*13+x*y)%5<2' > test.txt && ca/ca 'h[0]:=(a[-1,-1]>0)+(a[0,-1]>0)+(a[1,-1]>0)+(a[-1,0]>0)+(a[1,0]>0)+(a[-1,1]>0)+(a[0,1]>0)+(a[1,1]>0),v:=(v==0&&h[0]==3||v==1&&h[0]>=2&&h[0]<=3)' end 10 sync 1 3 < test.txt | core/diff2 \"ca/ca 'h[0]:=(a[-1,-1]>0)+(a[0,-1]>0)+(a[1,-1]>0)+(a[-1,0]>0)+(a[1,0]>0)+(a[-1,1]>0)+(a[0,1]>0)+(a[1,1]>0),v:=(v==0&&h[0]==3||v==1&&h[0]>=2&&h[0]<=3)' end 10 < test.txt\""
 
 # rotor stuff
+call_test "Testing rotor/rotor s (hint)" 1 "core/create 3 3 0 | rotor/rotor s 'core/create 3 3 0 | math/add 4' 4 | math/equation 'v==(x>0&&y==1)' | core/all_equals 1"
+call_test "Testing rotor/rotor p" 1 "core/create 20 20 0 | math/equation '(x==5&&y==7)*5000' > rotor_chips.txt && core/create 20 20 0 | math/equation '(x+2*y)%4' | rotor/rotor p 'cat rotor_chips.txt' 3 | core/diff2 \"core/create 20 20 0 | math/equation '(x+2*y)%4' | rotor/rotor s 'cat rotor_chips.txt' 145\""
 #call_test "Testing rotor/rotor s" 1 "core/create 10 10 0 | rotor/rotor s 'core/create 10 10 100' | core/diff2 \"core/create 10 10 0 | algo/S | rotor/rotor s 'core/create 10 10 100'\""
 #call_test "Testing rotor/rotor l" 1 "core/create 2 2 0 | math/equation 'min(x+y*2,2)' | rotor/rotor l 'core/create 2 2 0 | math/add 0' | io/avalanches_bin2human 2 | io/seq_to_field 2 2 | core/all_equals 1"
 #call_test "Testing io/convert" 1 "core/create 3 3 3 | io/convert numbers rotors | io/convert rotors numbers | core/all_equals 3"
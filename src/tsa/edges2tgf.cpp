@@ -25,14 +25,48 @@
 #include "general.h"
 #include "io.h"
 #include "stack_algorithm.h"
+#include "varint_log.h"
 
 int main(int argc, char** argv)
 {
 	(void)argv;
 	FILE* read_fp = stdin;
 	FILE* write_fp = stdout;
-	if(argc>1) {
-		fputs("There are no arguments for this tool.\n",stderr);
+	if(argc==3) {
+		// compressed avalanche log (see varint_log.h) for a grid of
+		// the given human dimension
+		const unsigned int width = atoi(argv[1]) + 2;
+		const unsigned int num_nodes = atoi(argv[2]) * (width - 2);
+		char hdr[24];
+		if(fread(hdr, sizeof(hdr), 1, read_fp) != 1 || hdr[14] != 0) {
+			fputs("Input is no compressed avalanche log.\n",stderr);
+			exit(1);
+		}
+		for(unsigned int i=1; i<=num_nodes;i++)
+		 fprintf(write_fp, "%d v_%d\n",i,i);
+		fprintf(write_fp, "#\n");
+
+		sandpile::varint_log_reader reader(read_fp);
+		using token_t = sandpile::varint_log_reader::token_t;
+		unsigned int current_node = 1;
+		int64_t idx;
+		token_t token;
+		while(current_node <= num_nodes
+			&& (token = reader.next(idx)) != token_t::eof)
+		{
+			if(token == token_t::separator)
+			 current_node++;
+			else
+			{
+				const unsigned int to_node = internal2human(idx,width)+1;
+				if(to_node != current_node) // avoid loops
+				 fprintf(write_fp, "%d %d\n", current_node, to_node);
+			}
+		}
+		return 0;
+	}
+	else if(argc>1) {
+		fputs("Only <width> <height> for compressed logs can be given.\n",stderr);
 		exit(1);
 	}
 